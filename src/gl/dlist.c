@@ -0,0 +1,407 @@
+/*
+** File:    dlist.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Display lists for animated programs. A program records what it
+**              draws each frame; when the frame is done, it is compared
+**              against the last one and only the areas where something
+**              changed are erased and drawn again
+*/
+
+/** Headers    **/
+#include "../kern/gcc16.h"
+#include "dlist.h"
+
+#include "../kern/kio.h"
+
+/** Macros     **/
+// command types
+#define DLIST_RECT      0
+#define DLIST_LINE      1
+#define DLIST_STR       2
+#define DLIST_IMG       3
+#define DLIST_CALL      4
+
+/** Structures **/
+
+// a recorded command. Text commands are followed by their string; every
+// command is padded out to a multiple of 4 bytes
+typedef struct DList_Cmd
+{
+    uint8_t type;
+    // line width or text/image scale
+    uint8_t arg;
+    // size of the command, including the string that follows it
+    uint16_t len;
+    // text uses color for the foreground and color2 for the background
+    RGB_8 color;
+    RGB_8 color2;
+    // area the command draws to
+    VGA_Rect bb;
+    union
+    {
+        // line end points. Text and images use p0 as the upper-left corner;
+        // text keeps its width boundary in p1.x, images their file id
+        struct
+        {
+            Point_2D p0;
+            Point_2D p1;
+        } pt;
+        struct
+        {
+            DList_Call fn;
+            uint16_t arg;
+        } call;
+    } u;
+} DList_Cmd;
+
+/************************** Internal Functions *************************/
+
+/*
+** Adds a command to the frame being recorded. Commands that don't fit are
+** dropped, and the frame is drawn in full; comparing it against the last one
+** would miss whatever the dropped command covered
+**
+** @param dl Display list
+** @param cmd Command to add
+** @param str String that follows the command, or NULL
+** @return False if the command was dropped
+*/
+static bool __dlist_add(DList* dl, const DList_Cmd* cmd, const char* str)
+{
+    uint16_t str_len = (str != NULL) ? kio_strlen(str) + 1 : 0;
+    uint16_t len = (sizeof(DList_Cmd) + str_len + 3) & ~3;
+    if ((dl->cur_len + len) > dl->cap)
+    {
+        dl->full = true;
+        return false;
+    }
+    DList_Cmd* dst = (DList_Cmd*)(dl->cur + dl->cur_len);
+    *dst = *cmd;
+    dst->len = len;
+    char* dst_str = (char*)(dst + 1);
+    for (uint16_t i=0; i<str_len; ++i)
+        dst_str[i] = str[i];
+    dl->cur_len += len;
+    return true;
+}
+
+/*
+** Checks if two recorded commands draw exactly the same thing
+**
+** @param a First command
+** @param b Second command
+** @return True if the commands are the same
+*/
+static bool __dlist_same(const DList_Cmd* a, const DList_Cmd* b)
+{
+    if ((a->type != b->type) || (a->arg != b->arg) || (a->len != b->len)
+        || !vga_RGB_8_cmp(a->color, b->color)
+        || !vga_RGB_8_cmp(a->color2, b->color2)
+        || (a->bb.x0 != b->bb.x0) || (a->bb.y0 != b->bb.y0)
+        || (a->bb.x1 != b->bb.x1) || (a->bb.y1 != b->bb.y1))
+    {
+        return false;
+    }
+    if (a->type == DLIST_CALL)
+    {
+        return (a->u.call.fn == b->u.call.fn)
+            && (a->u.call.arg == b->u.call.arg);
+    }
+    if ((a->u.pt.p0.x != b->u.pt.p0.x) || (a->u.pt.p0.y != b->u.pt.p0.y)
+        || (a->u.pt.p1.x != b->u.pt.p1.x) || (a->u.pt.p1.y != b->u.pt.p1.y))
+    {
+        return false;
+    }
+    if (a->type == DLIST_STR)
+        return kio_strcmp((const char*)(a + 1), (const char*)(b + 1));
+    return true;
+}
+
+/*
+** Marks the area of a command as needing to be drawn again
+**
+** @param dirty Areas to draw again
+** @param cmd Command that changed
+*/
+static void __dlist_damage(VGA_Dirty* dirty, const DList_Cmd* cmd)
+{
+    if ((cmd->bb.x0 < cmd->bb.x1) && (cmd->bb.y0 < cmd->bb.y1))
+    {
+        vga_dirty_add(dirty, cmd->bb.x0, cmd->bb.y0, cmd->bb.x1,
+            cmd->bb.y1);
+    }
+}
+
+/*
+** Draws a recorded command
+**
+** @param cmd Command to draw
+*/
+static void __dlist_draw(const DList_Cmd* cmd)
+{
+    switch (cmd->type)
+    {
+        case DLIST_RECT:
+            gl_draw_rect_wh(PT2(cmd->bb.x0, cmd->bb.y0),
+                cmd->bb.x1 - cmd->bb.x0, cmd->bb.y1 - cmd->bb.y0, cmd->color);
+            break;
+        case DLIST_LINE:
+            gl_draw_line_width(cmd->u.pt.p0, cmd->u.pt.p1, cmd->arg,
+                cmd->color);
+            break;
+        case DLIST_STR:
+            gl_draw_str_scale(cmd->u.pt.p0, cmd->color2, cmd->color,
+                (char*)(cmd + 1), cmd->arg, cmd->u.pt.p1.x);
+            break;
+        case DLIST_IMG:
+            gl_draw_img_scale(cmd->u.pt.p1.x, cmd->u.pt.p0, cmd->arg);
+            break;
+        case DLIST_CALL:
+            cmd->u.call.fn(cmd->u.call.arg);
+            break;
+    }
+}
+
+/************************** User Functions    **************************/
+
+/*
+** Sets up a display list
+**
+** @param dl Display list to set up
+** @param buff Memory for the display list. Half of it holds the frame being
+**        recorded, the other half the frame on the screen
+** @param size Size of buff, in bytes
+** @param bg Color the screen is filled with, underneath all the commands
+*/
+void dlist_init(DList* dl, uint8_t* buff, uint16_t size, RGB_8 bg)
+{
+    dl->cap = size / 2;
+    dl->cur = buff;
+    dl->prev = buff + dl->cap;
+    dl->cur_len = 0;
+    dl->prev_len = 0;
+    dl->bg = bg;
+    dl->full = true;
+}
+
+/*
+** Forgets what is on the screen, so that the next frame is drawn in full.
+** Use this after drawing to the screen without the display list
+**
+** @param dl Display list
+*/
+void dlist_reset(DList* dl)
+{
+    dl->full = true;
+}
+
+/*
+** Starts recording a frame
+**
+** @param dl Display list
+*/
+void dlist_begin(DList* dl)
+{
+    dl->cur_len = 0;
+}
+
+/*
+** Records a rectangle
+**
+** @param dl Display list
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param color Color of the rectangle
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_rect(DList* dl, Point_2D ul, uint16_t w, uint16_t h, RGB_8 color)
+{
+    DList_Cmd cmd = {0};
+    cmd.type = DLIST_RECT;
+    cmd.color = color;
+    cmd.bb.x0 = ul.x;
+    cmd.bb.y0 = ul.y;
+    cmd.bb.x1 = ul.x + w;
+    cmd.bb.y1 = ul.y + h;
+    return __dlist_add(dl, &cmd, NULL);
+}
+
+/*
+** Records a line
+**
+** @param dl Display list
+** @param p0 First point
+** @param p1 Second point
+** @param width Line width/thickness
+** @param color Color to draw
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_line(DList* dl, Point_2D p0, Point_2D p1, uint8_t width,
+    RGB_8 color)
+{
+    DList_Cmd cmd = {0};
+    cmd.type = DLIST_LINE;
+    cmd.arg = width;
+    cmd.color = color;
+    cmd.u.pt.p0 = p0;
+    cmd.u.pt.p1 = p1;
+    // lines are thickened to the right and downwards
+    cmd.bb.x0 = (p0.x < p1.x) ? p0.x : p1.x;
+    cmd.bb.y0 = (p0.y < p1.y) ? p0.y : p1.y;
+    cmd.bb.x1 = ((p0.x > p1.x) ? p0.x : p1.x) + width;
+    cmd.bb.y1 = ((p0.y > p1.y) ? p0.y : p1.y) + width;
+    return __dlist_add(dl, &cmd, NULL);
+}
+
+/*
+** Records a string. The string is copied, so it may change once this returns
+**
+** @param dl Display list
+** @param ul Upper-left starting point
+** @param b_color Background color of the text
+** @param f_color Foreground color of the text
+** @param str String to draw
+** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
+** @param w_bound Right-handed width to bound the text to. This is the maximum
+**        width value that can be drawn. After this word-wrapping is enforced
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_str(DList* dl, Point_2D ul, RGB_8 b_color, RGB_8 f_color,
+    char* str, uint8_t scale, uint16_t w_bound)
+{
+    DList_Cmd cmd = {0};
+    cmd.type = DLIST_STR;
+    cmd.arg = scale;
+    cmd.color = f_color;
+    cmd.color2 = b_color;
+    cmd.u.pt.p0 = ul;
+    cmd.u.pt.p1.x = w_bound;
+    Point_2D bb;
+    gl_draw_str_bb(ul, str, scale, w_bound, &bb);
+    cmd.bb.x0 = ul.x;
+    cmd.bb.y0 = ul.y;
+    cmd.bb.x1 = ul.x + bb.x;
+    cmd.bb.y1 = ul.y + bb.y;
+    return __dlist_add(dl, &cmd, str);
+}
+
+/*
+** Records an image "installed" on the OS
+**
+** @param dl Display list
+** @param fid File id that identifies the image data to draw
+** @param ul Upper-left starting point
+** @param scale Simple (integer) scale factor to make an image larger
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_img(DList* dl, uint8_t fid, Point_2D ul, uint8_t scale)
+{
+    DList_Cmd cmd = {0};
+    cmd.type = DLIST_IMG;
+    cmd.arg = scale;
+    cmd.u.pt.p0 = ul;
+    cmd.u.pt.p1.x = fid;
+    Point_2D dims;
+    gl_img_stat(fid, &dims);
+    cmd.bb.x0 = ul.x;
+    cmd.bb.y0 = ul.y;
+    cmd.bb.x1 = ul.x + (dims.x * scale);
+    cmd.bb.y1 = ul.y + (dims.y * scale);
+    return __dlist_add(dl, &cmd, NULL);
+}
+
+/*
+** Records a call to a function that draws something itself. The function
+** is called again whenever part of its area has to be drawn, with drawing
+** clipped to that part. It has to draw the same thing every time it is called
+** with the same argument, and only within its area
+**
+** @param dl Display list
+** @param fn Function to call
+** @param arg Argument to call the function with
+** @param ul Upper-left corner of the area the function draws to
+** @param w Width of the area
+** @param h Height of the area
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_call(DList* dl, DList_Call fn, uint16_t arg, Point_2D ul,
+    uint16_t w, uint16_t h)
+{
+    DList_Cmd cmd = {0};
+    cmd.type = DLIST_CALL;
+    cmd.u.call.fn = fn;
+    cmd.u.call.arg = arg;
+    cmd.bb.x0 = ul.x;
+    cmd.bb.y0 = ul.y;
+    cmd.bb.x1 = ul.x + w;
+    cmd.bb.y1 = ul.y + h;
+    return __dlist_add(dl, &cmd, NULL);
+}
+
+/*
+** Finishes a frame. Commands that changed since the last frame have their old
+** and new areas erased, then everything recorded that touches those areas is
+** drawn again. The recorded frame becomes the frame on the screen; it still
+** has to be shown with gl_present()
+**
+** @param dl Display list
+*/
+void dlist_end(DList* dl)
+{
+    VGA_Dirty dirty;
+    dirty.cnt = 0;
+    if (dl->full)
+        vga_dirty_add(&dirty, 0, 0, gl_getw(), gl_geth());
+    else
+    {
+        // commands are compared in the order they were recorded
+        uint16_t a = 0, b = 0;
+        while ((a < dl->prev_len) || (b < dl->cur_len))
+        {
+            const DList_Cmd* old = (a < dl->prev_len)
+                ? (const DList_Cmd*)(dl->prev + a) : NULL;
+            const DList_Cmd* new = (b < dl->cur_len)
+                ? (const DList_Cmd*)(dl->cur + b) : NULL;
+            if ((old == NULL) || (new == NULL) || !__dlist_same(old, new))
+            {
+                if (old != NULL)
+                    __dlist_damage(&dirty, old);
+                if (new != NULL)
+                    __dlist_damage(&dirty, new);
+            }
+            if (old != NULL)
+                a += old->len;
+            if (new != NULL)
+                b += new->len;
+        }
+    }
+    for (uint8_t i=0; i<dirty.cnt; ++i)
+    {
+        const VGA_Rect* r = &dirty.rect[i];
+        Point_2D ul = {r->x0, r->y0};
+        uint16_t w = r->x1 - r->x0, h = r->y1 - r->y0;
+        gl_push_clip(ul, w, h);
+        gl_draw_rect_wh(ul, w, h, dl->bg);
+        for (uint16_t c=0; c<dl->cur_len; )
+        {
+            const DList_Cmd* cmd = (const DList_Cmd*)(dl->cur + c);
+            if ((cmd->bb.x0 < r->x1) && (cmd->bb.x1 > r->x0)
+                && (cmd->bb.y0 < r->y1) && (cmd->bb.y1 > r->y0))
+            {
+                __dlist_draw(cmd);
+            }
+            c += cmd->len;
+        }
+        gl_pop_clip();
+    }
+    // the recorded frame is now the one on the screen
+    uint8_t* tmp = dl->prev;
+    dl->prev = dl->cur;
+    dl->cur = tmp;
+    dl->prev_len = dl->cur_len;
+    dl->cur_len = 0;
+    dl->full = false;
+}
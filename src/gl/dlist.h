@@ -0,0 +1,153 @@
+/*
+** File:    dlist.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Display lists for animated programs. A program records what it
+**              draws each frame; when the frame is done, it is compared
+**              against the last one and only the areas where something
+**              changed are erased and drawn again
+*/
+#ifndef _DLIST_H_
+#define _DLIST_H_
+
+/** Headers    **/
+#include "../kern/gcc16.h"
+#include "../kern/types.h"
+#include "../kern/vga/vga.h"
+#include "../gl/gl_lib.h"
+
+/** Macros     **/
+
+/** Globals    **/
+
+/** Structures **/
+
+// function recorded in a display list, see dlist_call()
+typedef void (*DList_Call)(uint16_t arg);
+
+// display list, see dlist_init()
+typedef struct DList
+{
+    // commands recorded for the frame being built and the frame on screen
+    uint8_t* cur;
+    uint8_t* prev;
+    uint16_t cur_len;
+    uint16_t prev_len;
+    // size of each of the two command buffers, in bytes
+    uint16_t cap;
+    // color the screen is filled with, underneath all the commands
+    RGB_8 bg;
+    // set when the frame on screen is unknown, or the frame being recorded
+    // ran out of room, and has to be drawn in full
+    bool full;
+} DList;
+
+/** Functions  **/
+
+/*
+** Sets up a display list
+**
+** @param dl Display list to set up
+** @param buff Memory for the display list. Half of it holds the frame being
+**        recorded, the other half the frame on the screen
+** @param size Size of buff, in bytes
+** @param bg Color the screen is filled with, underneath all the commands
+*/
+void dlist_init(DList* dl, uint8_t* buff, uint16_t size, RGB_8 bg);
+
+/*
+** Forgets what is on the screen, so that the next frame is drawn in full.
+** Use this after drawing to the screen without the display list
+**
+** @param dl Display list
+*/
+void dlist_reset(DList* dl);
+
+/*
+** Starts recording a frame
+**
+** @param dl Display list
+*/
+void dlist_begin(DList* dl);
+
+/*
+** Records a rectangle
+**
+** @param dl Display list
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param color Color of the rectangle
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_rect(DList* dl, Point_2D ul, uint16_t w, uint16_t h, RGB_8 color);
+
+/*
+** Records a line
+**
+** @param dl Display list
+** @param p0 First point
+** @param p1 Second point
+** @param width Line width/thickness
+** @param color Color to draw
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_line(DList* dl, Point_2D p0, Point_2D p1, uint8_t width,
+    RGB_8 color);
+
+/*
+** Records a string. The string is copied, so it may change once this returns
+**
+** @param dl Display list
+** @param ul Upper-left starting point
+** @param b_color Background color of the text
+** @param f_color Foreground color of the text
+** @param str String to draw
+** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
+** @param w_bound Right-handed width to bound the text to. This is the maximum
+**        width value that can be drawn. After this word-wrapping is enforced
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_str(DList* dl, Point_2D ul, RGB_8 b_color, RGB_8 f_color,
+    char* str, uint8_t scale, uint16_t w_bound);
+
+/*
+** Records an image "installed" on the OS
+**
+** @param dl Display list
+** @param fid File id that identifies the image data to draw
+** @param ul Upper-left starting point
+** @param scale Simple (integer) scale factor to make an image larger
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_img(DList* dl, uint8_t fid, Point_2D ul, uint8_t scale);
+
+/*
+** Records a call to a function that draws something itself. The function
+** is called again whenever part of its area has to be drawn, with drawing
+** clipped to that part. It has to draw the same thing every time it is called
+** with the same argument, and only within its area
+**
+** @param dl Display list
+** @param fn Function to call
+** @param arg Argument to call the function with
+** @param ul Upper-left corner of the area the function draws to
+** @param w Width of the area
+** @param h Height of the area
+** @return False if the display list is full; the command is dropped
+*/
+bool dlist_call(DList* dl, DList_Call fn, uint16_t arg, Point_2D ul,
+    uint16_t w, uint16_t h);
+
+/*
+** Finishes a frame. Commands that changed since the last frame have their old
+** and new areas erased, then everything recorded that touches those areas is
+** drawn again. The recorded frame becomes the frame on the screen; it still
+** has to be shown with gl_present()
+**
+** @param dl Display list
+*/
+void dlist_end(DList* dl);
+
+#endif
@@ -0,0 +1,373 @@
+/*
+** File:    gl_3d.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Wireframe 3D for the graphics library. Points are moved into
+**              the camera's view with fixed point 4x4 matrices, clipped to
+**              what the camera can see and projected onto the screen, where
+**              they are drawn with the regular line functions
+*/
+
+/** Headers    **/
+#include "../kern/gcc16.h"
+#include "gl_3d.h"
+
+/** Macros     **/
+// most points transformed at once; the batch is kept on the stack
+#define GL_3D_BATCH     16
+
+// planes a line is clipped against: the near plane, then the screen edges
+#define GL_PLANE_NEAR   0
+#define GL_PLANE_LEFT   1
+#define GL_PLANE_RIGHT  2
+#define GL_PLANE_TOP    3
+#define GL_PLANE_BOTTOM 4
+#define GL_PLANES       5
+
+/************************** Internal Functions *************************/
+
+/*
+** Finds which side of a clipping plane a point is on
+**
+** @param cam Camera
+** @param plane Plane (GL_PLANE_*)
+** @param p Point, in the camera's space
+** @return Positive or 0 if the point can be seen, negative if not. The size
+**         grows with the distance from the plane
+*/
+static int32_t __gl_plane_dist(const GL_Cam* cam, uint8_t plane,
+    const GL_Vec3* p)
+{
+    // the screen edges are planes through the camera: a point is on screen
+    // when its projection, focal * x / z, is within the edge
+    int64_t xf = (int64_t)p->x * cam->focal;
+    int64_t yf = (int64_t)p->y * cam->focal;
+    int64_t dist;
+    switch (plane)
+    {
+        case GL_PLANE_NEAR:
+            return p->z - cam->near;
+        case GL_PLANE_LEFT:
+            dist = xf + ((int64_t)p->z * cam->ctr.x);
+            break;
+        case GL_PLANE_RIGHT:
+            dist = ((int64_t)p->z * (cam->w - 1 - cam->ctr.x)) - xf;
+            break;
+        case GL_PLANE_TOP:
+            dist = ((int64_t)p->z * cam->ctr.y) - yf;
+            break;
+        default:
+            dist = yf + ((int64_t)p->z * (cam->h - 1 - cam->ctr.y));
+            break;
+    }
+    // drop the fraction bits, so the distances fit in 32 bits
+    return dist >> FIX16_SHIFT;
+}
+
+/*
+** Moves a point part of the way to another
+**
+** @param p Point to move
+** @param q Point to move towards
+** @param t How far to move, 16.16. 1.0 moves p onto q
+*/
+static void __gl_vec_lerp(GL_Vec3* p, const GL_Vec3* q, fix16_t t)
+{
+    p->x += fix_mul(q->x - p->x, t);
+    p->y += fix_mul(q->y - p->y, t);
+    p->z += fix_mul(q->z - p->z, t);
+}
+
+/*
+** Clips a line to what the camera can see
+**
+** @param cam Camera
+** @param p0 First end point, in the camera's space. Moved if it is clipped
+** @param p1 Second end point, in the camera's space. Moved if it is clipped
+** @return False if none of the line can be seen
+*/
+static bool __gl_line_clip_3d(const GL_Cam* cam, GL_Vec3* p0, GL_Vec3* p1)
+{
+    for (uint8_t plane=0; plane<GL_PLANES; ++plane)
+    {
+        int32_t d0 = __gl_plane_dist(cam, plane, p0);
+        int32_t d1 = __gl_plane_dist(cam, plane, p1);
+        if ((d0 < 0) && (d1 < 0))
+            return false;
+        // move the end point that is out to where the line crosses the plane
+        if (d0 < 0)
+            __gl_vec_lerp(p0, p1, fix_div(d0, d0 - d1));
+        else if (d1 < 0)
+            __gl_vec_lerp(p1, p0, fix_div(d1, d1 - d0));
+    }
+    return true;
+}
+
+/*
+** Finds where a point lands along one axis of the screen
+**
+** @param ctr Where the camera looks on the screen, along the axis
+** @param max Size of the screen, along the axis
+** @param ratio Coordinate of the point along the axis, over its distance
+** @param focal Distance to the screen, in pixels
+** @return Coordinate on the screen, cut off at the edges of the screen
+*/
+static uint16_t __gl_project_axis(uint16_t ctr, uint16_t max, fix16_t ratio,
+    uint16_t focal)
+{
+    int64_t v = ctr + (((int64_t)ratio * focal + (FIX16_ONE / 2))
+        >> FIX16_SHIFT);
+    return (v < 0) ? 0 : ((v > max) ? max : v);
+}
+
+/*
+** Projects a point onto the screen
+**
+** @param cam Camera
+** @param p Point, in the camera's space and past the near plane
+** @return Point on the screen
+*/
+static Point_2D __gl_project(const GL_Cam* cam, const GL_Vec3* p)
+{
+    Point_2D pt = {
+        __gl_project_axis(cam->ctr.x, cam->w, fix_div(p->x, p->z),
+            cam->focal),
+        __gl_project_axis(cam->ctr.y, cam->h, -fix_div(p->y, p->z),
+            cam->focal)
+    };
+    return pt;
+}
+
+/*
+** Draws a batch of separate 3D lines, see gl_draw_lines_3d()
+**
+** @param cam Camera to draw with
+** @param pts Line end points, in the world
+** @param n Number of points
+** @param width Line width/thickness
+** @param color Color to draw
+** @param ramp Ramp to anti-alias with or GL_RAMP_NONE for plain lines
+*/
+static void __gl_lines_3d(const GL_Cam* cam, const Point_3D* pts, uint16_t n,
+    uint8_t width, RGB_8 color, gl_ramp_t ramp)
+{
+    GL_Vec3 view[GL_3D_BATCH];
+    Point_2D scr[GL_3D_BATCH];
+    n &= ~1;
+    while (n > 0)
+    {
+        uint16_t batch = (n < GL_3D_BATCH) ? n : GL_3D_BATCH;
+        gl_mat_xform(&cam->view, pts, view, batch);
+        // lines that can't be seen are dropped from the batch
+        uint16_t cnt = 0;
+        for (uint16_t i=0; i<batch; i+=2)
+        {
+            if (__gl_line_clip_3d(cam, &view[i], &view[i + 1]))
+            {
+                scr[cnt++] = __gl_project(cam, &view[i]);
+                scr[cnt++] = __gl_project(cam, &view[i + 1]);
+            }
+        }
+        if (ramp == GL_RAMP_NONE)
+            gl_draw_lines(scr, cnt, width, color);
+        else
+        {
+            for (uint16_t i=0; i<cnt; i+=2)
+                gl_draw_line_aa_h(scr[i], scr[i + 1], ramp);
+        }
+        pts += batch;
+        n -= batch;
+    }
+}
+
+/************************** User Functions ****************************/
+
+/***** Matrix Functions (driver-independent)   *****/
+
+/*
+** Sets a matrix to the identity matrix
+**
+** @param m Matrix to set
+*/
+void gl_mat_identity(GL_Mat4* m)
+{
+    for (uint8_t r=0; r<4; ++r)
+    {
+        for (uint8_t c=0; c<4; ++c)
+            m->m[r][c] = (r == c) ? FIX16_ONE : 0;
+    }
+}
+
+/*
+** Multiplies two matrices. Transforming by the product is the same as
+** transforming by b, then by a
+**
+** @param out Product. May be the same as a or b
+** @param a Left-hand matrix
+** @param b Right-hand matrix
+*/
+void gl_mat_mul(GL_Mat4* out, const GL_Mat4* a, const GL_Mat4* b)
+{
+    GL_Mat4 prod;
+    for (uint8_t r=0; r<4; ++r)
+    {
+        for (uint8_t c=0; c<4; ++c)
+        {
+            fix16_t sum = 0;
+            for (uint8_t k=0; k<4; ++k)
+                sum += fix_mul(a->m[r][k], b->m[k][c]);
+            prod.m[r][c] = sum;
+        }
+    }
+    *out = prod;
+}
+
+/*
+** Adds a move to the end of a matrix's transformation
+**
+** @param m Matrix to change
+** @param x Distance along x
+** @param y Distance along y
+** @param z Distance along z
+*/
+void gl_mat_translate(GL_Mat4* m, fix16_t x, fix16_t y, fix16_t z)
+{
+    // same as multiplying by a translation matrix on the left, without the
+    // multiplies by 0 and 1
+    fix16_t t[3] = {x, y, z};
+    for (uint8_t r=0; r<3; ++r)
+    {
+        for (uint8_t c=0; c<4; ++c)
+            m->m[r][c] += fix_mul(t[r], m->m[3][c]);
+    }
+}
+
+/*
+** Adds a rotation to the end of a matrix's transformation
+**
+** @param m Matrix to change
+** @param axis Axis to rotate around (GL_AXIS_*)
+** @param a Angle to rotate by
+*/
+void gl_mat_rotate(GL_Mat4* m, uint8_t axis, fix_angle_t a)
+{
+    // the rotation works on the two axes that aren't the one rotated around
+    uint8_t i = (axis == GL_AXIS_X) ? 1 : 0;
+    uint8_t j = (axis == GL_AXIS_Z) ? 1 : 2;
+    fix16_t s = fix_sin(a), c = fix_cos(a);
+    GL_Mat4 rot;
+    gl_mat_identity(&rot);
+    rot.m[i][i] = c;
+    rot.m[j][j] = c;
+    // around y, the sines swap places to keep the rotation right-handed
+    rot.m[i][j] = (axis == GL_AXIS_Y) ? s : -s;
+    rot.m[j][i] = (axis == GL_AXIS_Y) ? -s : s;
+    gl_mat_mul(m, &rot, m);
+}
+
+/*
+** Transforms a batch of points
+**
+** @param m Transformation
+** @param pts Points to transform. Coordinates are integers and must be under
+**        32768, like the results
+** @param out Transformed points
+** @param n Number of points
+*/
+void gl_mat_xform(const GL_Mat4* m, const Point_3D* pts, GL_Vec3* out,
+    uint16_t n)
+{
+    for (uint16_t i=0; i<n; ++i)
+    {
+        // points are integers, so a plain multiply gives a 16.16 result
+        int32_t p[3] = {pts[i].x, pts[i].y, pts[i].z};
+        fix16_t v[3];
+        for (uint8_t r=0; r<3; ++r)
+        {
+            v[r] = (m->m[r][0] * p[0]) + (m->m[r][1] * p[1])
+                + (m->m[r][2] * p[2]) + m->m[r][3];
+        }
+        out[i].x = v[0];
+        out[i].y = v[1];
+        out[i].z = v[2];
+    }
+}
+
+/***** Camera Functions (driver-independent)   *****/
+
+/*
+** Sets up a camera looking down the z axis from the world's origin, at the
+** center of the screen. Move the camera by changing its view matrix; the view
+** matrix moves the world, so it does the opposite of what the camera does
+**
+** @param cam Camera to set up
+** @param focal Distance to the screen, in pixels. Half the screen width gives
+**        a 90 degree field of view
+** @param near Distance to the near plane. Nothing closer than this is drawn
+*/
+void gl_cam_init(GL_Cam* cam, uint16_t focal, fix16_t near)
+{
+    gl_mat_identity(&cam->view);
+    cam->focal = focal;
+    cam->near = near;
+    cam->w = gl_getw();
+    cam->h = gl_geth();
+    cam->ctr = PT2(cam->w / 2, cam->h / 2);
+}
+
+/*
+** Projects a point onto the screen
+**
+** @param cam Camera
+** @param pt Point, in the world
+** @param out Point on the screen. Points off of the screen are cut off at
+**        its edges
+** @return False if the point is behind the near plane, so it has no place on
+**         the screen
+*/
+bool gl_project_3d(const GL_Cam* cam, Point_3D pt, Point_2D* out)
+{
+    GL_Vec3 v;
+    gl_mat_xform(&cam->view, &pt, &v, 1);
+    if (v.z < cam->near)
+        return false;
+    *out = __gl_project(cam, &v);
+    return true;
+}
+
+/*
+** Draws a batch of separate 3D lines, all in one color. Every two points make
+** a line; an odd point at the end is ignored. Points are transformed and
+** projected a handful of lines at a time. Lines are cut off where they leave
+** the camera's view, so they never wrap around the screen
+**
+** @param cam Camera to draw with
+** @param pts Line end points, in the world
+** @param n Number of points
+** @param width Line width/thickness
+** @param color Color to draw
+*/
+void gl_draw_lines_3d(const GL_Cam* cam, const Point_3D* pts, uint16_t n,
+    uint8_t width, RGB_8 color)
+{
+    __gl_lines_3d(cam, pts, n, width, color, GL_RAMP_NONE);
+}
+
+/*
+** Draws a batch of separate 3D lines, anti-aliased against a background color.
+** Otherwise this is the same as gl_draw_lines_3d(), with 1 pixel wide lines
+**
+** @param cam Camera to draw with
+** @param pts Line end points, in the world
+** @param n Number of points
+** @param fg Line color
+** @param bg Background color
+*/
+void gl_draw_lines_3d_aa(const GL_Cam* cam, const Point_3D* pts, uint16_t n,
+    RGB_8 fg, RGB_8 bg)
+{
+    gl_ramp_t ramp = gl_ramp_resolve(bg, fg, GL_AA_LEVELS);
+    __gl_lines_3d(cam, pts, n, 1, fg, ramp);
+    gl_ramp_release(ramp);
+}
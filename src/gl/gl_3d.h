@@ -0,0 +1,168 @@
+/*
+** File:    gl_3d.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Wireframe 3D for the graphics library. Points are moved into
+**              the camera's view with fixed point 4x4 matrices, clipped to
+**              what the camera can see and projected onto the screen, where
+**              they are drawn with the regular line functions
+*/
+#ifndef _GL_3D_H_
+#define _GL_3D_H_
+
+/** Headers    **/
+#include "../kern/gcc16.h"
+#include "../kern/types.h"
+#include "../kern/fixed.h"
+#include "../gl/gl_lib.h"
+#include "../gl/gl_shape.h"
+
+/** Macros     **/
+// axes to rotate around, see gl_mat_rotate()
+#define GL_AXIS_X       0
+#define GL_AXIS_Y       1
+#define GL_AXIS_Z       2
+
+/** Globals    **/
+
+/** Structures **/
+
+// 16.16 fixed point 4x4 matrix, indexed by [row][column]. Points are column
+// vectors, multiplied on the right
+typedef struct GL_Mat4
+{
+    fix16_t m[4][4];
+} GL_Mat4;
+
+// 16.16 fixed point vector
+typedef struct GL_Vec3
+{
+    fix16_t x;
+    fix16_t y;
+    fix16_t z;
+} GL_Vec3;
+
+// camera, see gl_cam_init(). In the camera's space, x runs right, y runs up
+// and z runs away from the camera, into the screen
+typedef struct GL_Cam
+{
+    // moves points from the world into the camera's space
+    GL_Mat4 view;
+    // distance to the screen, in pixels; sets the field of view
+    uint16_t focal;
+    // nothing closer than this is drawn
+    fix16_t near;
+    // where the camera looks on the screen and the size of the screen
+    Point_2D ctr;
+    uint16_t w;
+    uint16_t h;
+} GL_Cam;
+
+/** Functions  **/
+
+/***** Matrix Functions (driver-independent)   *****/
+
+/*
+** Sets a matrix to the identity matrix
+**
+** @param m Matrix to set
+*/
+void gl_mat_identity(GL_Mat4* m);
+
+/*
+** Multiplies two matrices. Transforming by the product is the same as
+** transforming by b, then by a
+**
+** @param out Product. May be the same as a or b
+** @param a Left-hand matrix
+** @param b Right-hand matrix
+*/
+void gl_mat_mul(GL_Mat4* out, const GL_Mat4* a, const GL_Mat4* b);
+
+/*
+** Adds a move to the end of a matrix's transformation
+**
+** @param m Matrix to change
+** @param x Distance along x
+** @param y Distance along y
+** @param z Distance along z
+*/
+void gl_mat_translate(GL_Mat4* m, fix16_t x, fix16_t y, fix16_t z);
+
+/*
+** Adds a rotation to the end of a matrix's transformation
+**
+** @param m Matrix to change
+** @param axis Axis to rotate around (GL_AXIS_*)
+** @param a Angle to rotate by
+*/
+void gl_mat_rotate(GL_Mat4* m, uint8_t axis, fix_angle_t a);
+
+/*
+** Transforms a batch of points
+**
+** @param m Transformation
+** @param pts Points to transform. Coordinates are integers and must be under
+**        32768, like the results
+** @param out Transformed points
+** @param n Number of points
+*/
+void gl_mat_xform(const GL_Mat4* m, const Point_3D* pts, GL_Vec3* out,
+    uint16_t n);
+
+/***** Camera Functions (driver-independent)   *****/
+
+/*
+** Sets up a camera looking down the z axis from the world's origin, at the
+** center of the screen. Move the camera by changing its view matrix; the view
+** matrix moves the world, so it does the opposite of what the camera does
+**
+** @param cam Camera to set up
+** @param focal Distance to the screen, in pixels. Half the screen width gives
+**        a 90 degree field of view
+** @param near Distance to the near plane. Nothing closer than this is drawn
+*/
+void gl_cam_init(GL_Cam* cam, uint16_t focal, fix16_t near);
+
+/*
+** Projects a point onto the screen
+**
+** @param cam Camera
+** @param pt Point, in the world
+** @param out Point on the screen. Points off of the screen are cut off at
+**        its edges
+** @return False if the point is behind the near plane, so it has no place on
+**         the screen
+*/
+bool gl_project_3d(const GL_Cam* cam, Point_3D pt, Point_2D* out);
+
+/*
+** Draws a batch of separate 3D lines, all in one color. Every two points make
+** a line; an odd point at the end is ignored. Points are transformed and
+** projected a handful of lines at a time. Lines are cut off where they leave
+** the camera's view, so they never wrap around the screen
+**
+** @param cam Camera to draw with
+** @param pts Line end points, in the world
+** @param n Number of points
+** @param width Line width/thickness
+** @param color Color to draw
+*/
+void gl_draw_lines_3d(const GL_Cam* cam, const Point_3D* pts, uint16_t n,
+    uint8_t width, RGB_8 color);
+
+/*
+** Draws a batch of separate 3D lines, anti-aliased against a background color.
+** Otherwise this is the same as gl_draw_lines_3d(), with 1 pixel wide lines
+**
+** @param cam Camera to draw with
+** @param pts Line end points, in the world
+** @param n Number of points
+** @param fg Line color
+** @param bg Background color
+*/
+void gl_draw_lines_3d_aa(const GL_Cam* cam, const Point_3D* pts, uint16_t n,
+    RGB_8 fg, RGB_8 bg);
+
+#endif
@@ -16,8 +16,13 @@
 
 #include "../kern/debug.h"
 #include "../kern/kio.h"
+#include "../kern/mem_map.h"
 // VGA mode drivers
+#include "../kern/vga/cga.h"
+#include "../kern/vga/vga12.h"
 #include "../kern/vga/vga13.h"
+#include "../kern/vga/vgax.h"
+#include "../kern/vga/vbe.h"
 
 // Includes only needed local to the C file and don't need to be included
 // everywhere else (especially since these ones are fairly large)
@@ -29,6 +34,46 @@
 /** Macros     **/
 // byte used to indicate run-length endcoded section in the CXPM decoder
 #define CXPM_MARKER    0
+// size of a SeeFont character cell, padding included
+#define GL_CELL_W(scale) \
+    (((scale) * SEE_FONT_WIDTH) + (2 * SEE_FONT_PAD_HORZ))
+#define GL_CELL_H(scale) \
+    (((scale) * SEE_FONT_HEIGHT) + (2 * SEE_FONT_PAD_VERT))
+// width reported for a line of text. The padding is counted as if it were
+// scaled along with the glyph, as gl_draw_str_bb() always has
+#define GL_TEXT_W(cols, scale) \
+    ((cols) * (scale) * (SEE_FONT_WIDTH + (2 * SEE_FONT_PAD_HORZ)))
+// Cohen-Sutherland outcodes; which sides of the clip area a point is past
+#define GL_OUT_LEFT    0x1
+#define GL_OUT_RIGHT   0x2
+#define GL_OUT_TOP     0x4
+#define GL_OUT_BOTTOM  0x8
+// how deep clip rectangles can be nested
+#define GL_CLIP_DEPTH  8
+// most blocks a glyph can break down into; every other pixel lit
+#define GL_GLYPH_SPANS ((SEE_FONT_WIDTH / 2) * SEE_FONT_HEIGHT)
+// glyphs broken down into blocks, one per SeeFont character
+#define GL_GLYPHS      MEM_FAR(GL_Glyph, MEM_GLYPH_SPANS)
+// pixels of a dithered gradient row handed to the driver at once
+#define GL_GRAD_CHUNK  32
+
+/** Structures **/
+
+// block of lit pixels in a glyph, in font pixels
+typedef struct GL_Span
+{
+    uint8_t x;
+    uint8_t y;
+    uint8_t w;
+    uint8_t h;
+} GL_Span;
+
+// glyph broken down into blocks, see __gl_glyph()
+typedef struct GL_Glyph
+{
+    uint8_t cnt;
+    GL_Span span[GL_GLYPH_SPANS];
+} GL_Glyph;
 
 // this allows us to skip some intializations and tear-downs if the same
 // graphics mode has been entered multiple times
@@ -41,22 +86,409 @@ static VGA_Driver vga_driver = {
     TEXT_HEIGHT,
     (uint16_t*)TEXT_MEM_BEGIN,
     VGA_MODE_TEXT,
+    0,
     // set all the functions here; shouldn't be called in text mode so use
     // NULL for now
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+};
+
+// clip rectangles replaced by gl_push_clip(), to be brought back when popped
+static VGA_Rect gl_clip_stack[GL_CLIP_DEPTH];
+// number of gl_push_clip() calls without a gl_pop_clip(), counting ignored ones
+static uint8_t gl_clip_lvl = 0;
+// first time a SeeFont glyph is drawn it is broken down into blocks, kept in
+// GL_GLYPHS; a set bit marks a glyph that has been built
+static uint8_t gl_glyph_built[(SEE_FONT_NUM_CH + 7) / 8];
+// set when gl_present() should wait for the retrace first
+static bool gl_present_vsync = false;
+// set while drawing goes to the back buffer
+static bool gl_back_on = false;
+// context colors, used by the text functions that take color handles
+static gl_color_t gl_fg = 0;
+static gl_color_t gl_bg = 0;
+// 4x4 ordered dither thresholds, in 16ths. A pixel takes the next step of a
+// gradient when it is further past a step than its threshold
+static const uint8_t gl_bayer[4][4] =
+{
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
 };
 
 /************************** Internal Functions *************************/
 
+/*
+** Lets drawing use the whole screen again, forgetting any pushed clip
+** rectangles
+*/
+static void __gl_clip_reset(void)
+{
+    vga_screen.x0 = 0;
+    vga_screen.y0 = 0;
+    vga_screen.x1 = vga_driver.screen_w;
+    vga_screen.y1 = vga_driver.screen_h;
+    vga_clip = vga_screen;
+    gl_clip_lvl = 0;
+}
+
+/*
+** Draws a horizontal run of a line, thickened downwards
+**
+** @param x Left-most x coordinate of the run
+** @param y y coordinate of the run
+** @param len Length of the run
+** @param width Line width/thickness
+** @param color_code Color code to draw
+*/
+static void __gl_line_run_h(uint16_t x, uint16_t y, uint16_t len,
+    uint8_t width, uint8_t color_code)
+{
+    if (width == 1)
+        vga_driver.vga_hspan(x, y, len, color_code);
+    else
+        vga_driver.vga_draw_rect_wh(x, y, len, width, color_code);
+}
+
+/*
+** Draws a vertical run of a line, thickened to the right
+**
+** @param x x coordinate of the run
+** @param y Top-most y coordinate of the run
+** @param len Length of the run
+** @param width Line width/thickness
+** @param color_code Color code to draw
+*/
+static void __gl_line_run_v(uint16_t x, uint16_t y, uint16_t len,
+    uint8_t width, uint8_t color_code)
+{
+    if (width == 1)
+        vga_driver.vga_vspan(x, y, len, color_code);
+    else
+        vga_driver.vga_draw_rect_wh(x, y, width, len, color_code);
+}
+
+/*
+** Works out which sides of an area a point lies past
+**
+** @param x x coordinate of the point
+** @param y y coordinate of the point
+** @param area Area, with inclusive bounds
+** @return Outcode of the point, 0 if it is inside
+*/
+static uint8_t __gl_outcode(int32_t x, int32_t y, const VGA_Rect* area)
+{
+    uint8_t code = 0;
+    if (x < area->x0)
+        code |= GL_OUT_LEFT;
+    else if (x > area->x1)
+        code |= GL_OUT_RIGHT;
+    if (y < area->y0)
+        code |= GL_OUT_TOP;
+    else if (y > area->y1)
+        code |= GL_OUT_BOTTOM;
+    return code;
+}
+
+/*
+** Clips a line to the clip rectangle (Cohen-Sutherland). End points outside
+** of it are moved along the line to the edge they cross, so the slope of the
+** line is kept
+**
+** @param p0 First point, changed to the first point that is drawn
+** @param p1 Second point, changed to the last point that is drawn
+** @param width Line width/thickness
+** @return False if none of the line is in the clip rectangle
+*/
+static bool __gl_line_clip(Point_2D* p0, Point_2D* p1, uint8_t width)
+{
+    if ((vga_clip.x0 >= vga_clip.x1) || (vga_clip.y0 >= vga_clip.y1))
+        return false;
+    // thick lines grow down and to the right, so a line just above or to the
+    // left of the clip rectangle can still reach into it
+    VGA_Rect area = vga_clip;
+    area.x0 = (area.x0 > (width - 1)) ? area.x0 - (width - 1) : 0;
+    area.y0 = (area.y0 > (width - 1)) ? area.y0 - (width - 1) : 0;
+    --area.x1;
+    --area.y1;
+    // points left of or above the screen are stored as wrapped-around 16-bit
+    // numbers; read them back as negative
+    int32_t x0 = (int16_t)p0->x, y0 = (int16_t)p0->y;
+    int32_t x1 = (int16_t)p1->x, y1 = (int16_t)p1->y;
+    uint8_t code0 = __gl_outcode(x0, y0, &area);
+    uint8_t code1 = __gl_outcode(x1, y1, &area);
+    while (code0 | code1)
+    {
+        // both points past the same side
+        if (code0 & code1)
+            return false;
+        // move a point that is outside onto the edge it is past
+        uint8_t code = code0 ? code0 : code1;
+        int32_t x, y;
+        if (code & GL_OUT_TOP)
+        {
+            y = area.y0;
+            x = x0 + (((x1 - x0) * (y - y0)) / (y1 - y0));
+        }
+        else if (code & GL_OUT_BOTTOM)
+        {
+            y = area.y1;
+            x = x0 + (((x1 - x0) * (y - y0)) / (y1 - y0));
+        }
+        else if (code & GL_OUT_LEFT)
+        {
+            x = area.x0;
+            y = y0 + (((y1 - y0) * (x - x0)) / (x1 - x0));
+        }
+        else
+        {
+            x = area.x1;
+            y = y0 + (((y1 - y0) * (x - x0)) / (x1 - x0));
+        }
+        if (code == code0)
+        {
+            x0 = x;
+            y0 = y;
+            code0 = __gl_outcode(x0, y0, &area);
+        }
+        else
+        {
+            x1 = x;
+            y1 = y;
+            code1 = __gl_outcode(x1, y1, &area);
+        }
+    }
+    p0->x = x0;
+    p0->y = y0;
+    p1->x = x1;
+    p1->y = y1;
+    return true;
+}
+
+/*
+** Gets a SeeFont glyph broken down into blocks of lit pixels. Each run of lit
+** pixels in a row is a block, and blocks grow downwards over rows that have
+** the same run, so every block can be drawn as one rectangle at any scale
+**
+** @param idx Index of the glyph in the font table
+** @return Glyph blocks
+*/
+static const GL_Glyph* __gl_glyph(uint8_t idx)
+{
+    GL_Glyph* glyph = &GL_GLYPHS[idx];
+    uint8_t bit = 1 << (idx & 7);
+    if (gl_glyph_built[idx >> 3] & bit)
+        return glyph;
+    gl_glyph_built[idx >> 3] |= bit;
+    glyph->cnt = 0;
+    for (uint8_t y=0; y<SEE_FONT_HEIGHT; ++y)
+    {
+        // blocks added for this row can't grow into it
+        uint8_t row_start = glyph->cnt;
+        uint8_t row_map = see_font_tbl[idx][y];
+        uint8_t x = 0;
+        while (row_map != 0)
+        {
+            uint8_t w = 0;
+            for(; !(row_map & 0x80); row_map <<= 1)
+                ++x;
+            for(; row_map & 0x80; row_map <<= 1)
+                ++w;
+            uint8_t i = 0;
+            for (; i<row_start; ++i)
+            {
+                GL_Span* span = &glyph->span[i];
+                if ((span->x == x) && (span->w == w)
+                    && ((span->y + span->h) == y))
+                {
+                    ++span->h;
+                    break;
+                }
+            }
+            if (i == row_start)
+            {
+                GL_Span* span = &glyph->span[glyph->cnt++];
+                span->x = x;
+                span->y = y;
+                span->w = w;
+                span->h = 1;
+            }
+            x += w;
+        }
+    }
+    return glyph;
+}
+
+/*
+** Adds a scanline to a sorted list of band edges, unless it is already there
+**
+** @param edge Edges, sorted top to bottom
+** @param cnt Number of edges, updated in place
+** @param y Scanline to add
+*/
+static void __gl_edge_add(uint16_t* edge, uint16_t* cnt, uint16_t y)
+{
+    uint16_t i = *cnt;
+    while ((i > 0) && (edge[i - 1] > y))
+        --i;
+    if ((i > 0) && (edge[i - 1] == y))
+        return;
+    for (uint16_t j=*cnt; j>i; --j)
+        edge[j] = edge[j - 1];
+    edge[i] = y;
+    ++*cnt;
+}
+
+/*
+** Clips a rectangle for a batch and adds its top and bottom to the band edges
+**
+** @param r Clipped rectangle. Rectangles that are clipped away are left empty
+**        (y0 == y1), so that they never cover a band
+** @param ul Upper-left corner
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param edge Band edges, sorted top to bottom
+** @param edges Number of band edges, updated in place
+** @return False if nothing is left to draw
+*/
+static bool __gl_rect_clip(VGA_Rect* r, Point_2D ul, uint16_t w, uint16_t h,
+    uint16_t* edge, uint16_t* edges)
+{
+    r->x0 = ul.x;
+    r->y0 = ul.y;
+    r->x1 = ul.x + w;
+    r->y1 = ul.y + h;
+    if (!vga_clip_rect(&r->x0, &r->y0, &r->x1, &r->y1))
+    {
+        r->y1 = r->y0;
+        return false;
+    }
+    __gl_edge_add(edge, edges, r->y0);
+    __gl_edge_add(edge, edges, r->y1);
+    return true;
+}
+
+/*
+** Draws a clipped batch of rectangles, one band at a time. Every pair of
+** neighbouring edges is a band that the same set of rectangles covers; within
+** a band, rectangles are drawn in the order given. Only rectangles that
+** overlap others need that order, so the rest are drawn whole, in the band
+** they start in
+**
+** @param clip Clipped rectangles
+** @param codes Color code of each rectangle
+** @param n Number of rectangles
+** @param edge Band edges, sorted top to bottom
+** @param edges Number of band edges
+*/
+static void __gl_rect_bands(const VGA_Rect* clip, const uint8_t* codes,
+    uint16_t n, const uint16_t* edge, uint16_t edges)
+{
+    bool solo[GL_RECTS_MAX];
+    for (uint16_t i=0; i<n; ++i)
+    {
+        solo[i] = true;
+        for (uint16_t j=0; j<n; ++j)
+        {
+            if ((j != i) && (clip[i].x0 < clip[j].x1)
+                && (clip[j].x0 < clip[i].x1) && (clip[i].y0 < clip[j].y1)
+                && (clip[j].y0 < clip[i].y1))
+            {
+                solo[i] = false;
+            }
+        }
+    }
+    for (uint16_t e=1; e<edges; ++e)
+    {
+        uint16_t y0 = edge[e - 1], y1 = edge[e];
+        for (uint16_t i=0; i<n; ++i)
+        {
+            if ((clip[i].y0 > y0) || (clip[i].y1 < y1))
+                continue;
+            uint16_t h = y1 - y0;
+            if (solo[i])
+            {
+                if (clip[i].y0 != y0)
+                    continue;
+                h = clip[i].y1 - y0;
+            }
+            vga_driver.vga_draw_rect_wh(clip[i].x0, y0,
+                clip[i].x1 - clip[i].x0, h, codes[i]);
+        }
+    }
+}
+
+/*
+** Draws a batch of line segments in one color, top-most segment first
+**
+** @param pts Segment end points
+** @param segs Number of segments
+** @param step 2 if every segment has its own pair of points, 1 if segments
+**        share end points (a polyline)
+** @param width Line width/thickness
+** @param color Color to draw
+*/
+static void __gl_draw_segs(const Point_2D* pts, uint16_t segs, uint8_t step,
+    uint8_t width, RGB_8 color)
+{
+    if (segs == 0)
+        return;
+    // clip once; the whole batch is dropped if its bounds are off the clip area
+    uint16_t pt_cnt = (segs * step) + 2 - step;
+    uint16_t x0 = pts[0].x, y0 = pts[0].y, x1 = x0, y1 = y0;
+    for (uint16_t i=1; i<pt_cnt; ++i)
+    {
+        if (pts[i].x < x0)
+            x0 = pts[i].x;
+        if (pts[i].x > x1)
+            x1 = pts[i].x;
+        if (pts[i].y < y0)
+            y0 = pts[i].y;
+        if (pts[i].y > y1)
+            y1 = pts[i].y;
+    }
+    x1 += width;
+    y1 += width;
+    if (!vga_clip_rect(&x0, &y0, &x1, &y1))
+        return;
+    uint8_t color_code = vga_driver.vga_fetch_color(color);
+    // insertion sort on the top-most scanline of each segment. The batch is a
+    // single color, so the order segments are drawn in can't change the image
+    uint16_t order[segs];
+    uint16_t top[segs];
+    for (uint16_t i=0; i<segs; ++i)
+    {
+        const Point_2D* seg = pts + (i * step);
+        uint16_t y = (seg[0].y < seg[1].y) ? seg[0].y : seg[1].y;
+        uint16_t j = i;
+        for (; (j > 0) && (top[j - 1] > y); --j)
+        {
+            top[j] = top[j - 1];
+            order[j] = order[j - 1];
+        }
+        top[j] = y;
+        order[j] = i;
+    }
+    for (uint16_t i=0; i<segs; ++i)
+    {
+        const Point_2D* seg = pts + (order[i] * step);
+        gl_draw_line_width_h(seg[0], seg[1], width, color_code);
+    }
+}
+
 /************************** User Functions    **************************/
 
 /*
 ** Enter a graphical mode
 **
-** @param mode Graphics mode to select
+** @param mode Graphics mode to select. OR in VGA_MODE_KEEP_VRAM to bring back
+**        the screen as it was when the mode was last left (if supported)
 */
 void gl_enter(uint8_t mode)
 {
+    uint8_t flags = mode & ~VGA_MODE_MASK;
+    mode &= VGA_MODE_MASK;
     // skip initialization if we're already in the correct graphics mode
     // this speeds up the switch-over
     if (vga_driver.vga_mode == mode)
@@ -66,14 +498,43 @@ void gl_enter(uint8_t mode)
     }
     else
         gl_enter_lvl = 0;
-    // start handling text debugging in the back up buffer
-    kio_swap_fb();
+    if (vga_driver.vga_mode == VGA_MODE_TEXT)
+    {
+        // graphics modes draw over the font; hold on to it for gl_exit
+        vga_text_save();
+        // start handling text debugging in the back up buffer
+        kio_swap_fb();
+    }
+    else if (vga_driver.vga_exit != NULL)
+        vga_driver.vga_exit();
+    vga_driver.vga_flags = flags;
     switch (mode)
     {
+        case VGA_MODE_CGA4:
+            _cga4_enter(&vga_driver);
+            break;
+        case VGA_MODE_CGA5:
+            _cga5_enter(&vga_driver);
+            break;
+        case VGA_MODE_12:
+            _vga12_enter(&vga_driver);
+            break;
         case VGA_MODE_13:
             _vga13_enter(&vga_driver);
             break;
+        case VGA_MODE_X:
+            _vgax_enter(&vga_driver);
+            break;
+        case VGA_MODE_VBE:
+            _vbe_enter(&vga_driver);
+            break;
     }
+    __gl_clip_reset();
+    gl_present_vsync = false;
+    gl_back_on = false;
+    // handles don't carry over to another mode
+    gl_fg = 0;
+    gl_bg = 0;
 }
 
 /*
@@ -88,28 +549,50 @@ void gl_exit(void)
         --gl_enter_lvl;
         return;
     }
+    if (vga_driver.vga_exit != NULL)
+        vga_driver.vga_exit();
+    uint8_t mode = vga_driver.vga_mode;
     // reset to the default TEXT mode
     vga_driver.screen_w = TEXT_WIDTH;
     vga_driver.screen_h = TEXT_HEIGHT;
     vga_driver.frame_buff = (uint16_t*)TEXT_MEM_BEGIN;
     vga_driver.vga_mode = VGA_MODE_TEXT;
+    vga_driver.vga_flags = 0;
     vga_driver.vga_enter = NULL;
+    vga_driver.vga_exit = NULL;
     vga_driver.vga_clrscr = NULL;
     vga_driver.vga_vsync = NULL;
+    vga_driver.vga_present = NULL;
+    vga_driver.vga_fetch_color = NULL;
+    vga_driver.vga_pin_color = NULL;
+    vga_driver.vga_alloc_ramp = NULL;
+    vga_driver.vga_free_ramp = NULL;
     vga_driver.vga_put_pixel = NULL;
     vga_driver.vga_get_pixel = NULL;
     vga_driver.vga_draw_rect = NULL;
     vga_driver.vga_draw_rect_wh = NULL;
-    // punch it Chewie, make the jump back to text mode
-    // (BIOS wipes graphics memory for free)
-    __asm__ __volatile__("movb $0x03, %al\n");
-    __asm__ __volatile__("movb $0x00, %ah\n");
-    __asm__ __volatile__("int  $0x10\n");
-    // hide the cursor
-    __asm__ __volatile__("movb $0x00, %al\n");
-    __asm__ __volatile__("movb $0x01, %ah\n");
-    __asm__ __volatile__("movw $0x2607, %cx\n");
-    __asm__ __volatile__("int  $0x10\n");
+    vga_driver.vga_hspan = NULL;
+    vga_driver.vga_vspan = NULL;
+    vga_driver.vga_blit_row = NULL;
+    vga_driver.vga_blit_mask = NULL;
+    vga_driver.vga_copy_rect = NULL;
+    vga_driver.vga_back_buffer = NULL;
+    // punch it Chewie, make the jump back to text mode. Standard VGA modes are
+    // switched by programming the registers directly; VBE modes have extra
+    // hardware state only the BIOS knows how to undo
+    if (mode != VGA_MODE_VBE)
+        vga_text_enter();
+    else
+    {
+        __asm__ __volatile__("movb $0x03, %al\n");
+        __asm__ __volatile__("movb $0x00, %ah\n");
+        __asm__ __volatile__("int  $0x10\n");
+        // hide the cursor
+        __asm__ __volatile__("movb $0x00, %al\n");
+        __asm__ __volatile__("movb $0x01, %ah\n");
+        __asm__ __volatile__("movw $0x2607, %cx\n");
+        __asm__ __volatile__("int  $0x10\n");
+    }
     // bring the text back to the primary display buffer
     kio_swap_fb();
 }
@@ -155,13 +638,144 @@ void gl_clrscr(void)
 }
 
 /*
-** Vertical sync control. Useful for slow electron-gun-based displays
+** Vertical sync control. Useful for slow electron-gun-based displays. Pending
+** palette changes are sent to the display during the retrace
 */
 void gl_vsync(void)
 {
     vga_driver.vga_vsync();
 }
 
+/*
+** Pushes everything drawn so far out to the display. Call this once a frame
+** (or a static screen) is complete
+*/
+void gl_present(void)
+{
+    if (gl_present_vsync)
+        vga_driver.vga_vsync();
+    vga_driver.vga_present();
+}
+
+/*
+** Draws to a buffer in system memory instead of the screen. Nothing drawn
+** shows up until gl_present(), which then only copies the areas that changed.
+** This gets rid of flicker from clearing and redrawing the screen. Switching
+** modes turns the back buffer off again
+**
+** @param enable True to draw to the back buffer, false to draw directly to
+**        the screen again
+** @param vsync True to have gl_present() wait for the vertical retrace before
+**        copying
+** @return False if the current mode has no back buffer support
+*/
+bool gl_back_buffer(bool enable, bool vsync)
+{
+    gl_present_vsync = false;
+    if (vga_driver.vga_back_buffer == NULL)
+        return false;
+    vga_driver.vga_back_buffer(enable);
+    gl_back_on = enable;
+    gl_present_vsync = enable && vsync;
+    return true;
+}
+
+/***** Color Handles and Context                     *****/
+
+/*
+** Resolves a color into a handle for the current mode. Handles stay valid
+** until the mode changes or they are released, even across screen clears
+**
+** @param color Color to resolve
+** @return Handle to draw with
+*/
+gl_color_t gl_color_resolve(RGB_8 color)
+{
+    gl_color_t handle = vga_driver.vga_fetch_color(color);
+    if (vga_driver.vga_pin_color != NULL)
+        vga_driver.vga_pin_color(handle, true);
+    return handle;
+}
+
+/*
+** Lets go of a handle from gl_color_resolve(). Its color may be replaced once
+** the screen is cleared
+**
+** @param handle Handle to release
+*/
+void gl_color_release(gl_color_t handle)
+{
+    if (vga_driver.vga_pin_color != NULL)
+        vga_driver.vga_pin_color(handle, false);
+}
+
+/*
+** Resolves a ramp of colors that fade evenly from one color to another
+**
+** @param c0 Color of the first step
+** @param c1 Color of the last step
+** @param n Number of steps
+** @return Handle of the first step or GL_RAMP_NONE
+*/
+gl_ramp_t gl_ramp_resolve(RGB_8 c0, RGB_8 c1, uint8_t n)
+{
+    if (vga_driver.vga_alloc_ramp == NULL)
+        return GL_RAMP_NONE;
+    return vga_driver.vga_alloc_ramp(c0, c1, n);
+}
+
+/*
+** Lets go of a ramp from gl_ramp_resolve()
+**
+** @param ramp Ramp to release
+*/
+void gl_ramp_release(gl_ramp_t ramp)
+{
+    if ((ramp != GL_RAMP_NONE) && (vga_driver.vga_free_ramp != NULL))
+        vga_driver.vga_free_ramp(ramp);
+}
+
+/*
+** Sets the colors used by the text functions that take handles
+**
+** @param fg Foreground (text) color
+** @param bg Background color. Use the same handle as fg for a transparent
+**        background
+*/
+void gl_set_colors(gl_color_t fg, gl_color_t bg)
+{
+    gl_fg = fg;
+    gl_bg = bg;
+}
+
+/*
+** Saves the current drawing context
+**
+** @param ctx Context to save into
+*/
+void gl_ctx_save(GL_Context* ctx)
+{
+    ctx->fg = gl_fg;
+    ctx->bg = gl_bg;
+    ctx->clip = vga_clip;
+    ctx->back_buffer = gl_back_on;
+}
+
+/*
+** Brings back a drawing context saved in the current mode. The clip stack is
+** left as is; only the current clip rectangle is replaced
+**
+** @param ctx Context to load
+*/
+void gl_ctx_load(const GL_Context* ctx)
+{
+    gl_fg = ctx->fg;
+    gl_bg = ctx->bg;
+    vga_clip = ctx->clip;
+    if (ctx->back_buffer != gl_back_on)
+        gl_back_buffer(ctx->back_buffer, gl_present_vsync);
+}
+
 /* Draw functions */
 
 /*
@@ -171,6 +785,17 @@ void gl_vsync(void)
 ** @param color Pixel color to write. This is an index into the color palette
 */
 void gl_put_pixel(Point_2D pt, RGB_8 color)
+{
+    vga_driver.vga_put_pixel(pt.x, pt.y, vga_driver.vga_fetch_color(color));
+}
+
+/*
+** Draws a pixel to the screen, using a color handle
+**
+** @param pt Pixel position
+** @param color Handle from gl_color_resolve()
+*/
+void gl_put_pixel_h(Point_2D pt, gl_color_t color)
 {
     vga_driver.vga_put_pixel(pt.x, pt.y, color);
 }
@@ -194,6 +819,19 @@ void gl_get_pixel(Point_2D pt, RGB_8* color)
 ** @param color Pixel color to write. This is an index into the color palette
 */
 void gl_draw_rect(Point_2D ur, Point_2D ll, RGB_8 color)
+{
+    vga_driver.vga_draw_rect(ur.x, ur.y, ll.x, ll.y,
+        vga_driver.vga_fetch_color(color));
+}
+
+/*
+** Draws a simple rectangle, using a color handle
+**
+** @param ur Upper-right coordinate on the screen
+** @param ll Lower-left coordinate on the screen
+** @param color Handle from gl_color_resolve()
+*/
+void gl_draw_rect_h(Point_2D ur, Point_2D ll, gl_color_t color)
 {
     vga_driver.vga_draw_rect(ur.x, ur.y, ll.x, ll.y, color);
 }
@@ -207,103 +845,418 @@ void gl_draw_rect(Point_2D ur, Point_2D ll, RGB_8 color)
 ** @param color Pixel color to write. This is an index into the color palette
 */
 void gl_draw_rect_wh(Point_2D ul, uint16_t w, uint16_t h, RGB_8 color)
+{
+    vga_driver.vga_draw_rect_wh(ul.x, ul.y, w, h,
+        vga_driver.vga_fetch_color(color));
+}
+
+/*
+** Draws a simple rectangle, using a color handle
+**
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param color Handle from gl_color_resolve()
+*/
+void gl_draw_rect_wh_h(Point_2D ul, uint16_t w, uint16_t h, gl_color_t color)
 {
     vga_driver.vga_draw_rect_wh(ul.x, ul.y, w, h, color);
 }
 
+/*
+** Draws a horizontal run of pixels, using a color handle
+**
+** @param ul Left-most point of the run
+** @param w Number of pixels in the run
+** @param color Handle from gl_color_resolve()
+*/
+void gl_draw_hspan_h(Point_2D ul, uint16_t w, gl_color_t color)
+{
+    vga_driver.vga_hspan(ul.x, ul.y, w, color);
+}
+
+/*
+** Fills a rectangle with a gradient from one color to another
+**
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param c0 Color at the top, or the left for a horizontal gradient
+** @param c1 Color at the bottom, or the right
+** @param horz True for a gradient that runs from left to right
+*/
+void gl_draw_gradient_rect(Point_2D ul, uint16_t w, uint16_t h, RGB_8 c0,
+    RGB_8 c1, bool horz)
+{
+    gl_ramp_t ramp = gl_ramp_resolve(c0, c1, GL_GRAD_STEPS);
+    if (ramp == GL_RAMP_NONE)
+    {
+        gl_draw_rect_wh(ul, w, h, vga_RGB_8_step(c0, c1, 1, 3));
+        return;
+    }
+    gl_draw_gradient_rect_h(ul, w, h, ramp, GL_GRAD_STEPS, horz);
+    gl_ramp_release(ramp);
+}
+
+/*
+** Fills a rectangle with a gradient, using a ramp from gl_ramp_resolve()
+**
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param ramp Ramp to fill with
+** @param n Number of steps in the ramp
+** @param horz True for a gradient that runs from left to right
+*/
+void gl_draw_gradient_rect_h(Point_2D ul, uint16_t w, uint16_t h,
+    gl_ramp_t ramp, uint8_t n, bool horz)
+{
+    uint8_t pal[GL_GRAD_STEPS];
+    uint8_t idx[GL_GRAD_CHUNK];
+    if ((w == 0) || (h == 0) || (n == 0))
+        return;
+    if (n > GL_GRAD_STEPS)
+        n = GL_GRAD_STEPS;
+    for (uint8_t i=0; i<n; ++i)
+        pal[i] = ramp + i;
+    // step through the ramp in 16ths, with 16 more bits of fraction
+    uint16_t len = horz ? w : h;
+    uint32_t d_level = (len > 1) ? (((uint32_t)(n - 1) << 20) / (len - 1)) : 0;
+    for (uint16_t y=0; y<h; ++y)
+    {
+        const uint8_t* bayer = gl_bayer[(ul.y + y) & 3];
+        uint16_t level = (y * d_level) >> 16;
+        // rows of a vertical gradient that land right on a step are one span
+        if (!horz && ((level & 0xF) == 0))
+        {
+            vga_driver.vga_hspan(ul.x, ul.y + y, w, pal[level >> 4]);
+            continue;
+        }
+        for (uint16_t x=0; x<w; x+=GL_GRAD_CHUNK)
+        {
+            uint16_t cnt = ((w - x) < GL_GRAD_CHUNK) ? (w - x) : GL_GRAD_CHUNK;
+            for (uint16_t i=0; i<cnt; ++i)
+            {
+                if (horz)
+                    level = ((x + i) * d_level) >> 16;
+                idx[i] = (level >> 4)
+                    + (bayer[(ul.x + x + i) & 3] < (level & 0xF));
+            }
+            vga_driver.vga_blit_row(ul.x + x, ul.y + y, cnt, idx, pal,
+                VGA_BLIT_OPAQUE);
+        }
+    }
+}
+
+/*
+** Draws a 1 bit-per-pixel mask in the context colors set by gl_set_colors().
+** Set bits are drawn in the foreground color and clear bits in the
+** background color, or left alone if both colors are the same handle
+**
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the mask, in pixels
+** @param h Height of the mask, in pixels
+** @param bits Mask rows. The most significant bit is the left-most pixel
+** @param stride Number of bytes between the start of each mask row
+*/
+void gl_draw_mask_h(Point_2D ul, uint16_t w, uint16_t h, const uint8_t* bits,
+    uint16_t stride)
+{
+    vga_driver.vga_blit_mask(ul.x, ul.y, w, h, bits, stride, gl_fg,
+        (gl_bg != gl_fg) ? gl_bg : VGA_BLIT_CLEAR);
+}
+
+/***** Clipping Functions                            *****/
+
+/*
+** Restricts drawing to a rectangle, within whatever area drawing is already
+** restricted to. Anything outside of it is left alone by every draw function.
+** Each call should be matched by a call to gl_pop_clip(); if too many are
+** nested, the extra ones are ignored
+**
+** @param ul Upper-left corner of the area to draw in
+** @param w Width of the area
+** @param h Height of the area
+*/
+void gl_push_clip(Point_2D ul, uint16_t w, uint16_t h)
+{
+    if (gl_clip_lvl++ >= GL_CLIP_DEPTH)
+        return;
+    gl_clip_stack[gl_clip_lvl - 1] = vga_clip;
+    // intersect with the current clip rectangle. An empty result is fine; the
+    // driver rejects everything until this is popped
+    uint16_t x1 = ul.x + w, y1 = ul.y + h;
+    if (!vga_clip_rect(&ul.x, &ul.y, &x1, &y1))
+        x1 = ul.x;
+    vga_clip.x0 = ul.x;
+    vga_clip.y0 = ul.y;
+    vga_clip.x1 = x1;
+    vga_clip.y1 = y1;
+}
+
+/*
+** Undoes the last gl_push_clip(), going back to the area drawing was restricted
+** to before it
+*/
+void gl_pop_clip(void)
+{
+    if (gl_clip_lvl == 0)
+        return;
+    if (gl_clip_lvl-- > GL_CLIP_DEPTH)
+        return;
+    vga_clip = gl_clip_stack[gl_clip_lvl];
+}
+
 /***** String Draw Functions (driver-independent)    *****/
 
 /*
-** Calculates the bounding box of a string to draw from the bit-mapped SeeFont
+** Checks if a line of text fits in a width boundary
+**
+** @param ul_x Left-most x coordinate of the line
+** @param len Number of characters on the line
+** @param scale Font scale factor
+** @param w_bound Right-handed width the line has to fit in
+** @return True if the line fits
+*/
+static bool __gl_text_fits(uint16_t ul_x, uint16_t len, uint8_t scale,
+    uint16_t w_bound)
+{
+    return (ul_x + ((uint32_t)len * GL_CELL_W(scale))
+        + (2 * SEE_FONT_PAD_HORZ)) < w_bound;
+}
+
+/*
+** Ends a line of laid out text. Lines past the end of the table are dropped,
+** and the layout is marked as cut short
 **
+** @param txt Layout being built
+** @param start Index of the first character on the line
+** @param end Index just past the last character on the line
+*/
+static void __gl_text_push(GL_Text* txt, uint16_t start, uint16_t end)
+{
+    if (txt->cnt == GL_TEXT_LINES)
+    {
+        txt->cut = true;
+        return;
+    }
+    GL_Text_Line* line = &txt->line[txt->cnt++];
+    line->start = start;
+    line->len = end - start;
+    if (line->len > txt->cols)
+        txt->cols = line->len;
+}
+
+/*
+** Draws one SeeFont character cell
+**
+** @param cur Upper-left corner of the glyph, inside the cell padding
+** @param ch Character to draw. Characters the font doesn't have are blank
+** @param scale Font scale factor
+** @param b_code Background color code of the text
+** @param f_code Foreground color code of the text
+** @param opaque False to leave the background as it is
+*/
+static void __gl_draw_glyph(Point_2D cur, uint8_t ch, uint8_t scale,
+    uint8_t b_code, uint8_t f_code, bool opaque)
+{
+    if ((ch < SEE_FONT_START_CH)
+        || (ch >= (SEE_FONT_START_CH + SEE_FONT_NUM_CH)))
+        ch = ' ';
+    if (opaque && (scale > 1))
+    {
+        // quickly draw the background color using the rectangle draw
+        // function and use this assumption for other optimizations
+        vga_driver.vga_draw_rect_wh(cur.x - SEE_FONT_PAD_HORZ,
+            cur.y - SEE_FONT_PAD_VERT, GL_CELL_W(scale), GL_CELL_H(scale),
+            b_code);
+    }
+    const uint8_t* glyph = see_font_tbl[ch - SEE_FONT_START_CH];
+    if ((scale == 1) && opaque)
+    {
+        // blit the whole cell, padding rows included, so that every
+        // pixel is written once in either color
+        uint8_t cell[SEE_FONT_HEIGHT + (2 * SEE_FONT_PAD_VERT)] = {0};
+        for(uint8_t row=0; row<SEE_FONT_HEIGHT; ++row)
+            cell[SEE_FONT_PAD_VERT + row] = glyph[row];
+        vga_driver.vga_blit_mask(cur.x, cur.y - SEE_FONT_PAD_VERT,
+            SEE_FONT_WIDTH, sizeof(cell), cell, 1, f_code, b_code);
+        if (SEE_FONT_PAD_HORZ > 0)
+        {
+            vga_driver.vga_draw_rect_wh(cur.x - SEE_FONT_PAD_HORZ,
+                cur.y - SEE_FONT_PAD_VERT, SEE_FONT_PAD_HORZ,
+                sizeof(cell), b_code);
+            vga_driver.vga_draw_rect_wh(cur.x + SEE_FONT_WIDTH,
+                cur.y - SEE_FONT_PAD_VERT, SEE_FONT_PAD_HORZ,
+                sizeof(cell), b_code);
+        }
+    }
+    else if (scale == 1)
+    {
+        // the glyph is already a mask the driver can blit as is
+        vga_driver.vga_blit_mask(cur.x, cur.y, SEE_FONT_WIDTH,
+            SEE_FONT_HEIGHT, glyph, 1, f_code, VGA_BLIT_CLEAR);
+    }
+    else
+    {
+        // draw each block of lit pixels as one scaled rectangle
+        const GL_Glyph* blocks = __gl_glyph(ch - SEE_FONT_START_CH);
+        for(uint8_t i=0; i<blocks->cnt; ++i)
+        {
+            const GL_Span* span = &blocks->span[i];
+            vga_driver.vga_draw_rect_wh(cur.x + (span->x * scale),
+                cur.y + (span->y * scale), span->w * scale,
+                span->h * scale, f_code);
+        }
+    }
+}
+
+/*
+** Draws laid out text with color codes the driver already understands. Lines
+** below the clip rectangle are skipped
+**
+** @param txt Text to draw
 ** @param ul Upper-left starting point
-** @param str String to draw
+** @param b_code Background color code of the text
+** @param f_code Foreground color code of the text
+** @param opaque False to leave the background as it is
+*/
+static void __gl_draw_text(const GL_Text* txt, Point_2D ul, uint8_t b_code,
+    uint8_t f_code, bool opaque)
+{
+    uint8_t scale = txt->scale;
+    Point_2D cur = {0, ul.y + SEE_FONT_PAD_VERT};
+    for (uint8_t i=0; i<txt->cnt; ++i)
+    {
+        if ((cur.y - SEE_FONT_PAD_VERT) >= vga_clip.y1)
+            break;
+        const char* str = txt->str + txt->line[i].start;
+        cur.x = ul.x + SEE_FONT_PAD_HORZ;
+        for (uint16_t j=0; j<txt->line[i].len; ++j)
+        {
+            __gl_draw_glyph(cur, str[j], scale, b_code, f_code, opaque);
+            cur.x += GL_CELL_W(scale);
+        }
+        cur.y += GL_CELL_H(scale);
+    }
+}
+
+/*
+** Breaks a string into lines in one pass over it, for the bit-mapped SeeFont.
+** Lines end at newlines and are word-wrapped to fit the width boundary. The
+** layout holds the bounding box and can be drawn any number of times
+**
+** @param txt Layout to fill in. It points into str, which has to outlive it
+** @param ul Upper-left starting point
+** @param str String to lay out
 ** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
-** @param w_bound Right-handed width to bound the text to. This is the maximum 
+** @param w_bound Right-handed width to bound the text to. This is the maximum
 **        width value that can be drawn. After this word-wrapping is enforced
-** @param bb Point to store bounding box width and height information into
+** @return False if the text has more than GL_TEXT_LINES lines. The lines
+**         past that are dropped
 */
-void gl_draw_str_bb(Point_2D ul, char* str, uint8_t scale, uint16_t w_bound,
-    Point_2D* bb)
+bool gl_text_lay(GL_Text* txt, Point_2D ul, char* str, uint8_t scale,
+    uint16_t w_bound)
 {
     // enforce some limit on font scaling
     if ((scale < 1) || (scale > 127))
         scale = 1;
-    // clear the bounding box so additions can be made later
-    bb->x = 0; bb->y = 0;
-    // current position to draw
-    Point_2D cur = ul;
-    // keeps character row, col counters as we move along
-    Point_2D rc_cntr = {0, 0};
-    // pad vertically
-    cur.y += SEE_FONT_PAD_VERT;
-    bb->y += (scale * SEE_FONT_HEIGHT) + (2 * SEE_FONT_PAD_VERT);
-    // track the longest run of characters to calculate the max bb width
-    uint16_t ch_w_cntr = 0;
-    // loop until null byte
-    while(*str != '\0')
+    txt->str = str;
+    txt->scale = scale;
+    txt->cnt = 0;
+    txt->cols = 0;
+    txt->cut = false;
+    // start of the line being built and the last space seen; a space before
+    // the start of the line is not a place to wrap
+    uint16_t start = 0;
+    uint16_t brk = 0;
+    uint16_t i = 0;
+    for (; str[i] != '\0'; ++i)
     {
-        // encounter a newline, jump ahead to the next line
-        if (*str == '\n')
+        char ch = str[i];
+        if (ch == '\n')
         {
-            if (rc_cntr.x > ch_w_cntr)
-                ch_w_cntr = rc_cntr.x + 1;
-            // jump a row of chars down
-            rc_cntr.x = 0;
-            ++rc_cntr.y;
-            ++str;
-            // increase height of the bounding box
-            bb->y += (scale * SEE_FONT_HEIGHT) + (2 * SEE_FONT_PAD_VERT);
+            __gl_text_push(txt, start, i);
+            start = i + 1;
+            continue;
         }
-        else
+        if (!__gl_text_fits(ul.x, i + 1 - start, scale, w_bound))
         {
-            // enforce a simple, hacky, word-wrapping
-            // this works by checking how long the next word is after a space
-            // has been seen
-            uint16_t wrap_cntr = 0;
-            if (*str == ' ')
+            if ((brk > start) && __gl_text_fits(ul.x, i - brk, scale, w_bound))
             {
-                char* wrap_ptr = str;
-                ++wrap_ptr;
-                while ((*wrap_ptr != '\0') && (*wrap_ptr != ' '))
-                {
-                    ++wrap_cntr;
-                    ++wrap_ptr;
-                }
+                // move the word being built to the next line, dropping the
+                // space in front of it
+                __gl_text_push(txt, start, brk);
+                start = brk + 1;
             }
-            // enforce a newline if we are about to go out of bounds, in x
-            cur.x = ul.x
-                + (rc_cntr.x * ((scale * SEE_FONT_WIDTH) 
-                    + (2 * SEE_FONT_PAD_HORZ)))
-                + SEE_FONT_PAD_HORZ;
-            if ((cur.x + (scale * SEE_FONT_WIDTH)
-                + (3 * SEE_FONT_PAD_HORZ)
-                + (wrap_cntr * scale * SEE_FONT_WIDTH)) >= w_bound)
+            else if (i > start)
             {
-                if (*str == ' ')
-                    ++str;
-                if (rc_cntr.x > ch_w_cntr)
-                    ch_w_cntr = rc_cntr.x + 1;
-                // reset before draw
-                rc_cntr.x = 0;
-                ++rc_cntr.y;
-                cur.x = ul.x + SEE_FONT_PAD_HORZ;
-                // increase height of the bounding box
-                bb->y += (scale * SEE_FONT_HEIGHT) + (2 * SEE_FONT_PAD_VERT);
+                // no word to wrap, so break right here. A space at the
+                // break is dropped
+                __gl_text_push(txt, start, i);
+                start = (ch == ' ') ? i + 1 : i;
             }
-            cur.y = ul.y
-                + (rc_cntr.y * ((scale * SEE_FONT_HEIGHT)
-                + (2 * SEE_FONT_PAD_VERT)))
-                + SEE_FONT_PAD_VERT;
-            if (rc_cntr.x > ch_w_cntr)
-                ch_w_cntr = rc_cntr.x + 1;
-            // move right; the character to draw
-            ++rc_cntr.x;
-            ++str;
         }
+        if (ch == ' ')
+            brk = i;
     }
-    // calculate the bounding box width
-    bb->x = ch_w_cntr * (scale * (SEE_FONT_WIDTH + (2 * SEE_FONT_PAD_HORZ)));
+    __gl_text_push(txt, start, i);
+    txt->bb.x = GL_TEXT_W(txt->cols, scale);
+    txt->bb.y = txt->cnt * GL_CELL_H(scale);
+    return !txt->cut;
+}
+
+/*
+** Changes the scale of laid out text, keeping its lines. The string is not
+** looked at again
+**
+** @param txt Layout to change
+** @param ul Upper-left starting point
+** @param scale New font scale factor
+** @param w_bound Right-handed width the lines have to fit in
+** @return True if every line fits at the new scale. Otherwise the layout is
+**         left as it was
+*/
+bool gl_text_rescale(GL_Text* txt, Point_2D ul, uint8_t scale,
+    uint16_t w_bound)
+{
+    if ((scale < 1) || (scale > 127)
+        || !__gl_text_fits(ul.x, txt->cols, scale, w_bound))
+        return false;
+    txt->scale = scale;
+    txt->bb.x = GL_TEXT_W(txt->cols, scale);
+    txt->bb.y = txt->cnt * GL_CELL_H(scale);
+    return true;
+}
+
+/*
+** Draws laid out text in the context colors set by gl_set_colors(). The
+** background is transparent if both colors are the same handle
+**
+** @param txt Text to draw, see gl_text_lay()
+** @param ul Upper-left starting point
+*/
+void gl_draw_text_h(const GL_Text* txt, Point_2D ul)
+{
+    __gl_draw_text(txt, ul, gl_bg, gl_fg, gl_bg != gl_fg);
+}
+
+/*
+** Calculates the bounding box of a string to draw from the bit-mapped SeeFont
+**
+** @param ul Upper-left starting point
+** @param str String to draw
+** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
+** @param w_bound Right-handed width to bound the text to. This is the maximum 
+**        width value that can be drawn. After this word-wrapping is enforced
+** @param bb Point to store bounding box width and height information into
+*/
+void gl_draw_str_bb(Point_2D ul, char* str, uint8_t scale, uint16_t w_bound,
+    Point_2D* bb)
+{
+    GL_Text txt;
+    gl_text_lay(&txt, ul, str, scale, w_bound);
+    *bb = txt.bb;
 }
 
 /*
@@ -323,115 +1276,29 @@ void gl_draw_str_bb(Point_2D ul, char* str, uint8_t scale, uint16_t w_bound,
 void gl_draw_str_scale(Point_2D ul, RGB_8 b_color, RGB_8 f_color, char* str,
     uint8_t scale, uint16_t w_bound)
 {
-    // enforce some limit on font scaling
-    if ((scale < 1) || (scale > 127))
-        scale = 1;
-    // current position to draw
-    Point_2D cur = ul;
-    // keeps character row, col counters as we move along
-    Point_2D rc_cntr = {0, 0};
-    // pad vertically
-    cur.y += SEE_FONT_PAD_VERT;
-    // loop until null byte
-    while(*str != '\0')
-    {
-        // encounter a newline, jump ahead to the next line
-        if (*str == '\n')
-        {
-            // jump a row of chars down
-            rc_cntr.x = 0;
-            ++rc_cntr.y;
-            ++str;
-        }
-        else
-        {
-            uint8_t ch = *str;
-            // enforce a simple, hacky, word-wrapping
-            // this works by checking how long the next word is after a space
-            // has been seen
-            uint16_t wrap_cntr = 0;
-            if (ch == ' ')
-            {
-                char* wrap_ptr = str;
-                ++wrap_ptr;
-                while ((*wrap_ptr != '\0') && (*wrap_ptr != ' '))
-                {
-                    ++wrap_cntr;
-                    ++wrap_ptr;
-                }
-            }
-            // enforce a newline if we are about to go out of bounds, in x
-            cur.x = ul.x
-                + (rc_cntr.x * ((scale * SEE_FONT_WIDTH) 
-                    + (2 * SEE_FONT_PAD_HORZ)))
-                + SEE_FONT_PAD_HORZ;
-            if ((cur.x + (scale * SEE_FONT_WIDTH)
-                + (3 * SEE_FONT_PAD_HORZ)
-                + (wrap_cntr * scale * SEE_FONT_WIDTH)) >= w_bound)
-            {
-                if (ch == ' ')
-                {
-                    ++str;
-                    ch = *str;
-                }
-                // reset before draw
-                rc_cntr.x = 0;
-                ++rc_cntr.y;
-                cur.x = ul.x + SEE_FONT_PAD_HORZ;
-            }
-            cur.y = ul.y
-                + (rc_cntr.y * ((scale * SEE_FONT_HEIGHT)
-                + (2 * SEE_FONT_PAD_VERT)))
-                + SEE_FONT_PAD_VERT;
-            // check for transparent backgrounds; both colors are the same
-            if (!vga_RGB_8_cmp(b_color, f_color))
-            {
-                // quickly draw the background color using the rectangle draw
-                // function and use this assumption for other optimizations
-                vga_driver.vga_draw_rect_wh(
-                    ul.x + 
-                        (rc_cntr.x * ((scale * SEE_FONT_WIDTH)
-                            + (2 * SEE_FONT_PAD_HORZ))
-                        ),
-                    ul.y +
-                        (rc_cntr.y * ((scale * SEE_FONT_HEIGHT)
-                            + (2 * SEE_FONT_PAD_VERT))
-                        ),
-                    (scale * SEE_FONT_WIDTH)  + (2 * SEE_FONT_PAD_HORZ),
-                    (scale * SEE_FONT_HEIGHT) + (2 * SEE_FONT_PAD_VERT),
-                    b_color
-                );
-            }
-            for(uint8_t row=0; row<SEE_FONT_HEIGHT; ++row)
-            {
-                uint8_t row_map = see_font_tbl[ch - SEE_FONT_START_CH][row];
-                // skip empty rows
-                if (row_map != 0)
-                {
-                    uint8_t mask = 0b10000000;
-                    for(uint8_t col=0; col<SEE_FONT_WIDTH; ++col)
-                    {
-                        if (row_map & mask)
-                        {
-                            vga_driver.vga_draw_rect_wh(cur.x, cur.y,
-                                scale, scale, f_color);
-                        }
-                        mask >>= 1;
-                        cur.x += scale;
-                    }
-                }
-                // reset x, draw next row of font pixels
-                cur.x = ul.x
-                    + (rc_cntr.x *
-                        (scale * SEE_FONT_WIDTH) + (2 * SEE_FONT_PAD_HORZ))
-                    + SEE_FONT_PAD_HORZ;
-                cur.y += scale;
-            }
-            // move right; the character to draw
-            ++rc_cntr.x;
-            ++str;
-        }
-    }
+    GL_Text txt;
+    gl_text_lay(&txt, ul, str, scale, w_bound);
+    uint8_t b_code = vga_driver.vga_fetch_color(b_color);
+    uint8_t f_code = vga_driver.vga_fetch_color(f_color);
+    __gl_draw_text(&txt, ul, b_code, f_code, !vga_RGB_8_cmp(b_color, f_color));
+}
+
+/*
+** Draws a string in the context colors set by gl_set_colors(). The background
+** is transparent if both colors are the same handle
+**
+** @param ul Upper-left starting point
+** @param str String to draw
+** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
+** @param w_bound Right-handed width to bound the text to. This is the maximum 
+**        width value that can be drawn. After this word-wrapping is enforced
+*/
+void gl_draw_str_scale_h(Point_2D ul, char* str, uint8_t scale,
+    uint16_t w_bound)
+{
+    GL_Text txt;
+    gl_text_lay(&txt, ul, str, scale, w_bound);
+    gl_draw_text_h(&txt, ul);
 }
 
 /*
@@ -576,28 +1443,43 @@ void gl_draw_img_scale(uint8_t fid, Point_2D ul, uint8_t scale)
 
     // Phase 2:
     // build the bit-map color look-up table, organized as: {key, R, G, B}
-    RGB_8 color_map[color_space];
+    // colors are resolved to driver color codes once, up front
+    uint8_t color_map[color_space];
     // value that the table starts at when making look-up values
     // subsequent keys are guaranteed to be consecutive
     uint8_t start_code = fd[1][0];
     // add the colors to the table, based on the header information
     for(int i=1; i<color_space + 1; ++i)
-        color_map[fd[i][0] - start_code] = RGB(fd[i][1], fd[i][2], fd[i][3]);
+        color_map[fd[i][0] - start_code] = vga_driver.vga_fetch_color(
+            RGB(fd[i][1], fd[i][2], fd[i][3]));
+
+    // transparent pixels are skipped by the driver's row blit
+    uint16_t key = VGA_BLIT_OPAQUE;
+    if ((t_code != 0) && (t_code >= start_code))
+        key = t_code - start_code;
 
     // Phase 3:
-    // go over the image data, dropping pixels
+    // go over the image data, decoding each scanline into a row of color map
+    // indices that gets handed to the driver, once per scaled row
+    // the driver clips each row; the decoded row only needs to be long enough
+    // to reach the edge of the screen, which keeps it small enough for the
+    // stack
+    if (ul.x >= vga_driver.screen_w)
+        return;
+    uint16_t row_w = dims.x * scale;
+    if ((ul.x + row_w) > vga_driver.screen_w)
+        row_w = vga_driver.screen_w - ul.x;
+    uint8_t row[row_w];
     for(uint16_t y=0; y<dims.y; ++y)
     {
-        // skip drawing scanlines that are out-of-bounds
-        if (ul.y + (y * scale) > vga_driver.screen_h)
+        // nothing below the clip rectangle needs decoding
+        if ((ul.y + (y * scale)) >= vga_clip.y1)
             break;
-        // x determines if we have reached the end of the image
+        // x is the position in the decoded (scaled) row
         uint16_t x = 0;
         // x_b is they byte position on the line
         uint16_t x_b = 0;
-        // run until the end of the scanline or terminate if we go off the 
-        // screen
-        while((x < (dims.x * scale)) && ((ul.x + x) <= vga_driver.screen_w))
+        while(x < row_w)
         {
             // read in the color encoding; advancing to the next encoded
             // position in the process
@@ -612,62 +1494,26 @@ void gl_draw_img_scale(uint8_t fid, Point_2D ul, uint8_t scale)
                 // then this byte is the color key to draw
                 encode = fd[y + color_space + 1][x_b++];
             }
-            // perform the table look-up, on both pixels
-            // upper 4 bits
-            uint8_t c0_key = encode >> 4;
-            // lower 4 bits
-            uint8_t c1_key = encode & 0x0F;
-            RGB_8 color0 = color_map[c0_key - start_code];
-            RGB_8 color1 = color_map[c1_key - start_code];
-            // scale, taking account for the fact that 2 pixels are drawn at
-            // one time
-            uint16_t px_scale = 2 * scale;
-            uint16_t draw_w = run_len * px_scale;
-            uint16_t draw_h = scale;
-            // draw until far edge
-            if ((ul.x + x + draw_w) > vga_driver.screen_w)
-                draw_w = vga_driver.screen_w - (ul.x + x);
-            // draw larger region if codes match and check for transparency
-            if (c0_key == c1_key)
+            // upper 4 bits, then lower 4 bits; each pixel repeated by scale
+            uint8_t c0 = (encode >> 4) - start_code;
+            uint8_t c1 = (encode & 0x0F) - start_code;
+            for(uint16_t i=0; (i<run_len) && (x<row_w); ++i)
             {
-                if (c0_key != t_code)
-                {
-                    // draw with fast rectangles when possible; when both
-                    // colors are the same
-                    vga_driver.vga_draw_rect_wh(
-                        ul.x + x, ul.y + (y * scale),
-                        draw_w, draw_h, color0
-                    );
-                }
+                for(uint8_t s=0; (s<scale) && (x<row_w); ++s)
+                    row[x++] = c0;
+                for(uint8_t s=0; (s<scale) && (x<row_w); ++s)
+                    row[x++] = c1;
             }
-            else
+        }
+        // duplicate the scanline down for scaling; the driver clips
+        for(uint8_t s=0; s<scale; ++s)
+        {
+            uint16_t row_y = ul.y + (y * scale) + s;
+            if (row_y >= vga_clip.y0)
             {
-                for(uint16_t i=0; i<run_len; ++i)
-                {
-                    // bounds checking
-                    if ((ul.x + x + scale) > vga_driver.screen_w)
-                        break;
-                    // check for transparency
-                    if (c0_key != t_code)
-                    {
-                        // draw the pixels, individually accounting for scale
-                        vga_driver.vga_draw_rect_wh(
-                            ul.x + x, ul.y + (y * scale),
-                            scale, draw_h, color0
-                        );
-                    }
-                    if ((ul.x + x + (2 * scale)) > vga_driver.screen_w)
-                        break;
-                    if (c1_key != t_code)
-                    {
-                        vga_driver.vga_draw_rect_wh(
-                            ul.x + x + scale, ul.y + (y * scale),
-                            scale, draw_h, color1
-                        );
-                    }
-                }
+                vga_driver.vga_blit_row(ul.x, row_y, row_w, row, color_map,
+                    key);
             }
-            x += run_len * px_scale;
         }
     }
 }
@@ -709,25 +1555,33 @@ void gl_draw_img_center_scale(uint8_t fid, uint8_t scale)
 */
 void gl_draw_line_width(Point_2D p0, Point_2D p1, uint8_t width, RGB_8 color)
 {
+    gl_draw_line_width_h(p0, p1, width, vga_driver.vga_fetch_color(color));
+}
+
+/*
+** Draw a line anywhere on the screen, using a color handle
+**
+** @param p0 First point
+** @param p1 Second point
+** @param width Line width/thickness
+** @param color Handle from gl_color_resolve()
+*/
+void gl_draw_line_width_h(Point_2D p0, Point_2D p1, uint8_t width,
+    gl_color_t color)
+{
+    // only the part of the line in the clip rectangle is stepped through
+    if (!__gl_line_clip(&p0, &p1, width))
+        return;
     // start by performing the left-right coordinate check-and-swap
     if (p0.x > p1.x)
     {
         Point_2D tp = p0;
         p0 = p1; p1 = tp;
     }
-    // bound points to within the draw space
-    if (p0.x > vga_driver.screen_w)
-        p0.x = vga_driver.screen_w;
-    if (p1.x > vga_driver.screen_w)
-        p1.x = vga_driver.screen_w;
-    if (p0.y > vga_driver.screen_h)
-        p0.y = vga_driver.screen_h;
-    if (p1.y > vga_driver.screen_h)
-        p1.y = vga_driver.screen_h;
 
     // check for optimized line drawing
     if (p0.y == p1.y)
-        vga_driver.vga_draw_rect_wh(p0.x, p0.y, p1.x-p0.x + 1, width, color);
+        __gl_line_run_h(p0.x, p0.y, p1.x-p0.x + 1, width, color);
     else if (p0.x == p1.x)
     {
         // perform the "left-right" swapping of the coordinates but for drawing
@@ -737,7 +1591,7 @@ void gl_draw_line_width(Point_2D p0, Point_2D p1, uint8_t width, RGB_8 color)
             Point_2D tp = p0;
             p0 = p1, p1=tp;
         }
-        vga_driver.vga_draw_rect_wh(p0.x, p0.y, width, p1.y-p0.y + 1, color);
+        __gl_line_run_v(p0.x, p0.y, p1.y-p0.y + 1, width, color);
     }
     else
     {
@@ -750,12 +1604,10 @@ void gl_draw_line_width(Point_2D p0, Point_2D p1, uint8_t width, RGB_8 color)
             {
                 // negative slopes
                 if (p0.y < p1.y)
-                    vga_driver.vga_draw_rect_wh(p0.x + i, p0.y + i, width, 1,
-                        color);
+                    vga_driver.vga_hspan(p0.x + i, p0.y + i, width, color);
                 // positive slopes
                 else
-                    vga_driver.vga_draw_rect_wh(p0.x + i, p0.y - i, width, 1,
-                        color);
+                    vga_driver.vga_hspan(p0.x + i, p0.y - i, width, color);
             }
         }
         // draw...everything else (in the octants)
@@ -779,20 +1631,29 @@ void gl_draw_line_width(Point_2D p0, Point_2D p1, uint8_t width, RGB_8 color)
             {
                 // as dy can be + or -, >= or <= checks aren't going to
                 // cut it. So instead we will loop until we ~ reach p1...(*)
+                // pixels that share an x are drawn as one vertical run,
+                // starting at run_y
+                int16_t run_y = y;
                 for (; y != p1.y; y += incr_y)
                 {
-                    // color and pick the next pixel
-                    vga_driver.vga_draw_rect_wh(x, y, width, 1, color);
+                    // pick the next pixel
                     if (delta <= 0)
                         delta += dE;
                     else
                     {
+                        // moving over; finish the run
+                        __gl_line_run_v(x, (incr_y > 0) ? run_y : y,
+                            (incr_y > 0) ? (y - run_y + 1) : (run_y - y + 1),
+                            width, color);
+                        run_y = y + incr_y;
                         x += incr_x;
                         delta += dNE;
                     }
                 }
-                // (*)... and then draw the last point at p1
-                vga_driver.vga_put_pixel(x, y, color);
+                // (*)... and then draw the last run, ending at p1
+                __gl_line_run_v(x, (incr_y > 0) ? run_y : y,
+                    (incr_y > 0) ? (y - run_y + 1) : (run_y - y + 1),
+                    width, color);
             }
             // draw gradual-sloped  lines (first and last octant)
             // this works similar to the code above but is a bit simpler as dx
@@ -804,19 +1665,131 @@ void gl_draw_line_width(Point_2D p0, Point_2D p1, uint8_t width, RGB_8 color)
                 dNE = (dy > 0) ? 2 * (dy - dx) : 2 * (-dy - dx);
                 // initial delta value
                 delta = dE - dx;
+                // pixels that share a y are drawn as one horizontal run,
+                // starting at run_x
+                int16_t run_x = x;
                 for (; x <= p1.x; x += incr_x)
                 {
-                    // color and pick the next pixel
-                    vga_driver.vga_draw_rect_wh(x, y, 1, width, color);
+                    // pick the next pixel
                     if (delta <= 0)
                         delta += dE;
                     else
                     {
+                        // moving up or down; finish the run
+                        __gl_line_run_h(run_x, y, x - run_x + 1, width, color);
+                        run_x = x + incr_x;
                         y += incr_y;
                         delta += dNE;
                     }
                 }
+                if (run_x <= p1.x)
+                    __gl_line_run_h(run_x, y, p1.x - run_x + 1, width, color);
             }
         }
     }
 }
+
+/***** Batch Draw Functions (driver-independent)     *****/
+
+/*
+** Draws a batch of rectangles. Rectangles are clipped and their colors are
+** looked up once for the whole batch, then drawn in horizontal bands from the
+** top of the screen down. Where rectangles overlap, later ones still cover
+** earlier ones. Batches larger than GL_RECTS_MAX are drawn in parts
+**
+** @param rects Rectangles to draw
+** @param n Number of rectangles
+*/
+void gl_draw_rects(const GL_Rect* rects, uint16_t n)
+{
+    VGA_Rect clip[GL_RECTS_MAX];
+    uint8_t codes[GL_RECTS_MAX];
+    uint16_t edge[2 * GL_RECTS_MAX];
+    // neighbouring rectangles tend to share colors
+    RGB_8 last = RGB_BLACK;
+    uint8_t last_code = 0;
+    bool have_last = false;
+    // each part is drawn before the next, so later parts still cover earlier
+    // ones
+    for (; n; rects+=GL_RECTS_MAX)
+    {
+        uint16_t cnt = (n < GL_RECTS_MAX) ? n : GL_RECTS_MAX;
+        uint16_t edges = 0;
+        n -= cnt;
+        for (uint16_t i=0; i<cnt; ++i)
+        {
+            if (!__gl_rect_clip(&clip[i], rects[i].ul, rects[i].w,
+                rects[i].h, edge, &edges))
+            {
+                continue;
+            }
+            if (!have_last || !vga_RGB_8_cmp(rects[i].color, last))
+            {
+                last = rects[i].color;
+                last_code = vga_driver.vga_fetch_color(last);
+                have_last = true;
+            }
+            codes[i] = last_code;
+        }
+        __gl_rect_bands(clip, codes, cnt, edge, edges);
+    }
+}
+
+/*
+** Draws a batch of rectangles with colors from gl_color_resolve(). Otherwise
+** this is the same as gl_draw_rects()
+**
+** @param rects Rectangles to draw
+** @param n Number of rectangles
+*/
+void gl_draw_rects_h(const GL_Rect_H* rects, uint16_t n)
+{
+    VGA_Rect clip[GL_RECTS_MAX];
+    uint8_t codes[GL_RECTS_MAX];
+    uint16_t edge[2 * GL_RECTS_MAX];
+    for (; n; rects+=GL_RECTS_MAX)
+    {
+        uint16_t cnt = (n < GL_RECTS_MAX) ? n : GL_RECTS_MAX;
+        uint16_t edges = 0;
+        n -= cnt;
+        for (uint16_t i=0; i<cnt; ++i)
+        {
+            __gl_rect_clip(&clip[i], rects[i].ul, rects[i].w, rects[i].h,
+                edge, &edges);
+            codes[i] = rects[i].color;
+        }
+        __gl_rect_bands(clip, codes, cnt, edge, edges);
+    }
+}
+
+/*
+** Draws a batch of separate lines, all in one color. Every two points make a
+** line; an odd point at the end is ignored
+**
+** @param pts Line end points
+** @param n Number of points
+** @param width Line width/thickness
+** @param color Color to draw
+*/
+void gl_draw_lines(const Point_2D* pts, uint16_t n, uint8_t width,
+    RGB_8 color)
+{
+    __gl_draw_segs(pts, n / 2, 2, width, color);
+}
+
+/*
+** Draws connected lines through a list of points, all in one color
+**
+** @param pts Points to connect, in order. Repeat the first point at the end
+**        to close the shape
+** @param n Number of points
+** @param width Line width/thickness
+** @param color Color to draw
+*/
+void gl_draw_polyline(const Point_2D* pts, uint16_t n, uint8_t width,
+    RGB_8 color)
+{
+    if (n > 1)
+        __gl_draw_segs(pts, n - 1, 1, width, color);
+}
+
@@ -17,6 +17,8 @@
 #include "../kern/types.h"
 // vga.h defines RGB_8
 #include "../kern/vga/vga.h"
+#include "../kern/vga/vbe.h"
+#include "see_font.h"
 
 /** Globals    **/
 
@@ -35,12 +37,78 @@ typedef struct Point_3D
     uint16_t z;
 } Point_3D;
 
+// a color resolved ahead of time for the current mode (see gl_color_resolve())
+typedef uint8_t gl_color_t;
+// a run of color handles that fade from one color to another (see
+// gl_ramp_resolve()). Step k of the ramp is drawn with handle ramp + k
+typedef uint16_t gl_ramp_t;
+
+// rectangle in a batch, see gl_draw_rects()
+typedef struct GL_Rect
+{
+    Point_2D ul;
+    uint16_t w;
+    uint16_t h;
+    RGB_8 color;
+} GL_Rect;
+// same as GL_Rect, with a color handle instead, see gl_draw_rects_h()
+typedef struct GL_Rect_H
+{
+    Point_2D ul;
+    uint16_t w;
+    uint16_t h;
+    gl_color_t color;
+} GL_Rect_H;
+
+// drawing state that can be saved and brought back as a whole
+typedef struct GL_Context
+{
+    // colors used by the text functions that take handles
+    gl_color_t fg;
+    gl_color_t bg;
+    // area drawing is restricted to
+    VGA_Rect clip;
+    // true if drawing goes to the back buffer
+    bool back_buffer;
+} GL_Context;
+
+// most lines a text layout holds; enough to fill the tallest screen (VBE) at
+// scale 1
+#define GL_TEXT_LINES \
+    (VBE_HEIGHT / (SEE_FONT_HEIGHT + (2 * SEE_FONT_PAD_VERT)))
+// line of laid out text, as a run of characters in the string
+typedef struct GL_Text_Line
+{
+    uint16_t start;
+    uint16_t len;
+} GL_Text_Line;
+// string broken into lines once, for measuring and drawing (see gl_text_lay())
+typedef struct GL_Text
+{
+    char* str;
+    uint8_t scale;
+    // number of lines and the length of the longest one, in characters
+    uint8_t cnt;
+    uint16_t cols;
+    // size of the text on the screen
+    Point_2D bb;
+    // set if lines past GL_TEXT_LINES were dropped
+    bool cut;
+    GL_Text_Line line[GL_TEXT_LINES];
+} GL_Text;
+
 /** Macros     **/
 // short-hand, "in-place" initializers
 #define PT2(X, Y)       (Point_2D){X, Y}
 #define PT3(X, Y, Z)    (Point_3D){X, Y, Z}
 // RGB is defined by vga.h for convience
 #define RGB(R, G, B)    (RGB_8){R, G, B}
+// gl_ramp_resolve() result when the mode has no room for a ramp
+#define GL_RAMP_NONE    VGA_RAMP_NONE
+// most steps a gradient is drawn with, see gl_draw_gradient_rect()
+#define GL_GRAD_STEPS   16
+// most rectangles gl_draw_rects() works out at once, on the stack
+#define GL_RECTS_MAX    16
 
 // common colors, available to user programs
 #define RGB_BLACK       RGB(  0,   0,   0)
@@ -56,7 +124,8 @@ typedef struct Point_3D
 /*
 ** Enter a graphical mode
 **
-** @param mode Graphics mode to select
+** @param mode Graphics mode to select. OR in VGA_MODE_KEEP_VRAM to bring back
+**        the screen as it was when the mode was last left (if supported)
 */
 void gl_enter(uint8_t mode);
 
@@ -94,10 +163,96 @@ uint16_t gl_geth(void);
 void gl_clrscr(void);
 
 /*
-** Vertical sync control. Useful for slow electron-gun-based displays
+** Vertical sync control. Useful for slow electron-gun-based displays. Pending
+** palette changes are sent to the display during the retrace
 */
 void gl_vsync(void);
 
+/*
+** Pushes everything drawn so far out to the display. Call this once a frame
+** (or a static screen) is complete
+*/
+void gl_present(void);
+
+/*
+** Draws to a buffer in system memory instead of the screen. Nothing drawn
+** shows up until gl_present(), which then only copies the areas that changed.
+** This gets rid of flicker from clearing and redrawing the screen. Switching
+** modes turns the back buffer off again
+**
+** @param enable True to draw to the back buffer, false to draw directly to
+**        the screen again
+** @param vsync True to have gl_present() wait for the vertical retrace before
+**        copying
+** @return False if the current mode has no back buffer support
+*/
+bool gl_back_buffer(bool enable, bool vsync);
+
+/***** Color Handles and Context                     *****/
+
+/*
+** Resolves a color into a handle for the current mode. Handles stay valid
+** until the mode changes or they are released, even across screen clears.
+** Drawing with a handle skips looking the color up on every call
+**
+** @param color Color to resolve
+** @return Handle to draw with
+*/
+gl_color_t gl_color_resolve(RGB_8 color);
+
+/*
+** Lets go of a handle from gl_color_resolve(). Its color may be replaced once
+** the screen is cleared
+**
+** @param handle Handle to release
+*/
+void gl_color_release(gl_color_t handle);
+
+/*
+** Resolves a ramp of colors that fade evenly from one color to another. The
+** handles are consecutive, so a shade can be picked with simple math instead
+** of looking each color up. Ramps stay valid until the mode changes or they
+** are released
+**
+** @param c0 Color of the first step
+** @param c1 Color of the last step
+** @param n Number of steps
+** @return Handle of the first step or GL_RAMP_NONE if the mode can't spare the
+**         colors
+*/
+gl_ramp_t gl_ramp_resolve(RGB_8 c0, RGB_8 c1, uint8_t n);
+
+/*
+** Lets go of a ramp from gl_ramp_resolve()
+**
+** @param ramp Ramp to release. GL_RAMP_NONE is ignored
+*/
+void gl_ramp_release(gl_ramp_t ramp);
+
+/*
+** Sets the colors used by the text functions that take handles
+**
+** @param fg Foreground (text) color
+** @param bg Background color. Use the same handle as fg for a transparent
+**        background
+*/
+void gl_set_colors(gl_color_t fg, gl_color_t bg);
+
+/*
+** Saves the current drawing context
+**
+** @param ctx Context to save into
+*/
+void gl_ctx_save(GL_Context* ctx);
+
+/*
+** Brings back a drawing context saved in the current mode. The clip stack is
+** left as is; only the current clip rectangle is replaced
+**
+** @param ctx Context to load
+*/
+void gl_ctx_load(const GL_Context* ctx);
+
 /*
 ** Draws a pixel to the screen. Coordinates start in the upper-left corner
 **
@@ -106,6 +261,14 @@ void gl_vsync(void);
 */
 void gl_put_pixel(Point_2D pt, RGB_8 color);
 
+/*
+** Draws a pixel to the screen, using a color handle
+**
+** @param pt Pixel position
+** @param color Handle from gl_color_resolve()
+*/
+void gl_put_pixel_h(Point_2D pt, gl_color_t color);
+
 /*
 ** Gets a pixel's color value. Coordinates start in the upper-left corner
 **
@@ -123,6 +286,15 @@ void gl_get_pixel(Point_2D pt, RGB_8* color);
 */
 void gl_draw_rect(Point_2D ur, Point_2D ll, RGB_8 color);
 
+/*
+** Draws a simple rectangle, using a color handle
+**
+** @param ur Upper-right coordinate on the screen
+** @param ll Lower-left coordinate on the screen
+** @param color Handle from gl_color_resolve()
+*/
+void gl_draw_rect_h(Point_2D ur, Point_2D ll, gl_color_t color);
+
 /*
 ** Draws a simple rectangle, using alternative parameter listings
 **
@@ -133,8 +305,132 @@ void gl_draw_rect(Point_2D ur, Point_2D ll, RGB_8 color);
 */
 void gl_draw_rect_wh(Point_2D ul, uint16_t w, uint16_t h, RGB_8 color);
 
+/*
+** Draws a simple rectangle, using a color handle
+**
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param color Handle from gl_color_resolve()
+*/
+void gl_draw_rect_wh_h(Point_2D ul, uint16_t w, uint16_t h, gl_color_t color);
+
+/*
+** Draws a horizontal run of pixels, using a color handle
+**
+** @param ul Left-most point of the run
+** @param w Number of pixels in the run
+** @param color Handle from gl_color_resolve()
+*/
+void gl_draw_hspan_h(Point_2D ul, uint16_t w, gl_color_t color);
+
+/*
+** Fills a rectangle with a gradient from one color to another. The colors
+** between are reserved once as a palette ramp, so each row is drawn in a
+** single call without looking up any colors. Pixels between two steps of the
+** ramp are dithered. Modes that can't spare a ramp get a flat fill in the
+** color half way between
+**
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param c0 Color at the top, or the left for a horizontal gradient
+** @param c1 Color at the bottom, or the right
+** @param horz True for a gradient that runs from left to right
+*/
+void gl_draw_gradient_rect(Point_2D ul, uint16_t w, uint16_t h, RGB_8 c0,
+    RGB_8 c1, bool horz);
+
+/*
+** Fills a rectangle with a gradient, using a ramp from gl_ramp_resolve().
+** Otherwise this is the same as gl_draw_gradient_rect()
+**
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param ramp Ramp to fill with
+** @param n Number of steps in the ramp, up to GL_GRAD_STEPS
+** @param horz True for a gradient that runs from left to right
+*/
+void gl_draw_gradient_rect_h(Point_2D ul, uint16_t w, uint16_t h,
+    gl_ramp_t ramp, uint8_t n, bool horz);
+
+/*
+** Draws a 1 bit-per-pixel mask in the context colors set by gl_set_colors().
+** Set bits are drawn in the foreground color and clear bits in the
+** background color, or left alone if both colors are the same handle
+**
+** @param ul Upper-left coordinate on the screen
+** @param w Width of the mask, in pixels
+** @param h Height of the mask, in pixels
+** @param bits Mask rows. The most significant bit is the left-most pixel
+** @param stride Number of bytes between the start of each mask row
+*/
+void gl_draw_mask_h(Point_2D ul, uint16_t w, uint16_t h, const uint8_t* bits,
+    uint16_t stride);
+
+/***** Clipping Functions                            *****/
+
+/*
+** Restricts drawing to a rectangle, within whatever area drawing is already
+** restricted to. Anything outside of it is left alone by every draw function.
+** Each call should be matched by a call to gl_pop_clip(); if too many are
+** nested, the extra ones are ignored
+**
+** @param ul Upper-left corner of the area to draw in
+** @param w Width of the area
+** @param h Height of the area
+*/
+void gl_push_clip(Point_2D ul, uint16_t w, uint16_t h);
+
+/*
+** Undoes the last gl_push_clip(), going back to the area drawing was restricted
+** to before it
+*/
+void gl_pop_clip(void);
+
 /***** String Draw Functions (driver-independent)    *****/
 
+/*
+** Breaks a string into lines in one pass over it, for the bit-mapped SeeFont.
+** Lines end at newlines and are word-wrapped to fit the width boundary. The
+** layout holds the bounding box and can be drawn any number of times
+**
+** @param txt Layout to fill in. It points into str, which has to outlive it
+** @param ul Upper-left starting point
+** @param str String to lay out
+** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
+** @param w_bound Right-handed width to bound the text to. This is the maximum
+**        width value that can be drawn. After this word-wrapping is enforced
+** @return False if the text has more than GL_TEXT_LINES lines. The lines
+**         past that are dropped
+*/
+bool gl_text_lay(GL_Text* txt, Point_2D ul, char* str, uint8_t scale,
+    uint16_t w_bound);
+
+/*
+** Changes the scale of laid out text, keeping its lines. The string is not
+** looked at again
+**
+** @param txt Layout to change
+** @param ul Upper-left starting point
+** @param scale New font scale factor
+** @param w_bound Right-handed width the lines have to fit in
+** @return True if every line fits at the new scale. Otherwise the layout is
+**         left as it was
+*/
+bool gl_text_rescale(GL_Text* txt, Point_2D ul, uint8_t scale,
+    uint16_t w_bound);
+
+/*
+** Draws laid out text in the context colors set by gl_set_colors(). The
+** background is transparent if both colors are the same handle
+**
+** @param txt Text to draw, see gl_text_lay()
+** @param ul Upper-left starting point
+*/
+void gl_draw_text_h(const GL_Text* txt, Point_2D ul);
+
 /*
 ** Calculates the bounding box of a string to draw from the bit-mapped SeeFont
 **
@@ -177,6 +473,27 @@ void gl_draw_str_scale(Point_2D ul, RGB_8 b_color, RGB_8 f_color, char* str,
 */
 void gl_draw_str(Point_2D ul, RGB_8 b_color, RGB_8 f_color, char* str);
 
+/*
+** Draws a string in the context colors set by gl_set_colors(). The background
+** is transparent if both colors are the same handle
+**
+** @param ul Upper-left starting point
+** @param str String to draw
+** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
+** @param w_bound Right-handed width to bound the text to. This is the maximum 
+**        width value that can be drawn. After this word-wrapping is enforced
+*/
+void gl_draw_str_scale_h(Point_2D ul, char* str, uint8_t scale,
+    uint16_t w_bound);
+
+/*
+** Draws a string in the context colors set by gl_set_colors()
+**
+** @param ul Upper-left starting point
+** @param str String to draw
+*/
+#define gl_draw_str_h(ul, str) gl_draw_str_scale_h(ul, str, 1, gl_getw())
+
 /*
 ** Calculates the bounding box of a string to draw from the bit-mapped SeeFont
 ** using kio_sprintf
@@ -312,4 +629,70 @@ void gl_draw_line_width(Point_2D p0, Point_2D p1, uint8_t width, RGB_8 color);
 */
 #define gl_draw_line(p0, p1, color) gl_draw_line_width(p0, p1, 1, color)
 
+/*
+** Draw a line anywhere on the screen, using a color handle
+**
+** @param p0 First point
+** @param p1 Second point
+** @param width Line width/thickness
+** @param color Handle from gl_color_resolve()
+*/
+void gl_draw_line_width_h(Point_2D p0, Point_2D p1, uint8_t width,
+    gl_color_t color);
+
+/*
+** Draw a line anywhere on the screen, using a color handle
+**
+** @param p0 First point
+** @param p1 Second point
+** @param color Handle from gl_color_resolve()
+*/
+#define gl_draw_line_h(p0, p1, color) gl_draw_line_width_h(p0, p1, 1, color)
+
+/***** Batch Draw Functions (driver-independent)     *****/
+
+/*
+** Draws a batch of rectangles. Rectangles are clipped and their colors are
+** looked up once for the whole batch, then drawn in horizontal bands from the
+** top of the screen down. Where rectangles overlap, later ones still cover
+** earlier ones. Batches larger than GL_RECTS_MAX are drawn in parts
+**
+** @param rects Rectangles to draw
+** @param n Number of rectangles
+*/
+void gl_draw_rects(const GL_Rect* rects, uint16_t n);
+
+/*
+** Draws a batch of rectangles with colors from gl_color_resolve(). Otherwise
+** this is the same as gl_draw_rects()
+**
+** @param rects Rectangles to draw
+** @param n Number of rectangles
+*/
+void gl_draw_rects_h(const GL_Rect_H* rects, uint16_t n);
+
+/*
+** Draws a batch of separate lines, all in one color. Every two points make a
+** line; an odd point at the end is ignored
+**
+** @param pts Line end points
+** @param n Number of points
+** @param width Line width/thickness
+** @param color Color to draw
+*/
+void gl_draw_lines(const Point_2D* pts, uint16_t n, uint8_t width,
+    RGB_8 color);
+
+/*
+** Draws connected lines through a list of points, all in one color
+**
+** @param pts Points to connect, in order. Repeat the first point at the end
+**        to close the shape
+** @param n Number of points
+** @param width Line width/thickness
+** @param color Color to draw
+*/
+void gl_draw_polyline(const Point_2D* pts, uint16_t n, uint8_t width,
+    RGB_8 color);
+
 #endif
@@ -0,0 +1,591 @@
+/*
+** File:    gl_shape.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Shapes for the graphics library. Shapes are broken down into
+**              horizontal spans, from the top of the shape down, and each
+**              span is handed to the driver as a single run
+*/
+
+/** Headers    **/
+#include "../kern/gcc16.h"
+#include "gl_shape.h"
+
+/** Macros     **/
+// fixed point x coordinates carry 14 fraction bits, which leaves room for the
+// difference of any two signed 16-bit coordinates. Points are unsigned, so a
+// coordinate left of the screen arrives as a large number; it is read as signed
+#define GL_FIX_SHIFT    14
+#define GL_FIX(v)       ((int32_t)(int16_t)(v) << GL_FIX_SHIFT)
+// first pixel at or to the right of a fixed point x coordinate
+#define GL_FIX_CEIL(v)  (((v) + GL_FIX(1) - 1) >> GL_FIX_SHIFT)
+
+/** Structures **/
+
+// polygon edge, see gl_fill_poly_h()
+typedef struct GL_Edge
+{
+    // scanlines the edge covers; y1 is not included
+    int16_t y0;
+    int16_t y1;
+    // x on the current scanline and the change in x on each scanline
+    int32_t x;
+    int32_t dx;
+} GL_Edge;
+
+// ellipse being drawn, see __gl_ellipse()
+typedef struct GL_Ellipse
+{
+    int16_t cx;
+    int16_t cy;
+    gl_color_t color;
+    bool fill;
+    // arcs only draw the pixels between the directions v0 and v1, going
+    // clockwise. Sectors wider than half of the ellipse are flagged
+    bool arc;
+    bool wide;
+    int32_t v0_x;
+    int32_t v0_y;
+    int32_t v1_x;
+    int32_t v1_y;
+} GL_Ellipse;
+
+/************************** Internal Functions *************************/
+
+/*
+** Draws a span of pixels, cutting off any part outside of the clip rectangle
+**
+** @param y Scanline
+** @param x0 Left-most pixel
+** @param x1 Pixel just past the right-most one
+** @param color Handle from gl_color_resolve()
+*/
+static void __gl_span(int32_t y, int32_t x0, int32_t x1, gl_color_t color)
+{
+    if ((y < vga_clip.y0) || (y >= vga_clip.y1))
+        return;
+    if (x0 < vga_clip.x0)
+        x0 = vga_clip.x0;
+    if (x1 > vga_clip.x1)
+        x1 = vga_clip.x1;
+    if (x1 > x0)
+        gl_draw_hspan_h(PT2(x0, y), x1 - x0, color);
+}
+
+/*
+** Fills the pixels of a scanline that lie between two x coordinates
+**
+** @param y Scanline
+** @param x0 Left edge, fixed point
+** @param x1 Right edge, fixed point
+** @param color Handle from gl_color_resolve()
+*/
+static void __gl_fill_span(int16_t y, int32_t x0, int32_t x1,
+    gl_color_t color)
+{
+    __gl_span(y, GL_FIX_CEIL(x0), GL_FIX_CEIL(x1), color);
+}
+
+/*
+** Draws part of an ellipse row. Arcs break the row up into the runs of pixels
+** that lie in their sector
+**
+** @param e Ellipse
+** @param dy Row, relative to the center
+** @param x0 Left-most pixel, relative to the center
+** @param x1 Right-most pixel, relative to the center
+*/
+static void __gl_ellipse_run(const GL_Ellipse* e, int16_t dy, int16_t x0,
+    int16_t x1)
+{
+    if (!e->arc)
+    {
+        __gl_span(e->cy + dy, e->cx + x0, e->cx + x1 + 1, e->color);
+        return;
+    }
+    int16_t run = x0;
+    for (int16_t x=x0; x<=(x1 + 1); ++x)
+    {
+        // on screen, y runs down, so a positive cross product is clockwise
+        bool in = false;
+        if (x <= x1)
+        {
+            bool past_v0 = ((e->v0_x * dy) - (e->v0_y * x)) >= 0;
+            bool before_v1 = ((x * e->v1_y) - (dy * e->v1_x)) >= 0;
+            in = e->wide ? (past_v0 || before_v1) : (past_v0 && before_v1);
+        }
+        if (!in)
+        {
+            __gl_span(e->cy + dy, e->cx + run, e->cx + x, e->color);
+            run = x + 1;
+        }
+    }
+}
+
+/*
+** Draws the rows of an ellipse that are dy above and below its center
+**
+** @param e Ellipse
+** @param dy Row, relative to the center
+** @param w Half-width of the ellipse on this row
+** @param inner Pixels closer to the center than this are inside the outline
+*/
+static void __gl_ellipse_rows(const GL_Ellipse* e, int16_t dy, int16_t w,
+    int16_t inner)
+{
+    for (int8_t side=0; side<((dy == 0) ? 1 : 2); ++side, dy=-dy)
+    {
+        if (e->fill || (inner == 0))
+            __gl_ellipse_run(e, dy, -w, w);
+        else
+        {
+            __gl_ellipse_run(e, dy, -w, -inner);
+            __gl_ellipse_run(e, dy, inner, w);
+        }
+    }
+}
+
+/*
+** Draws an ellipse with the midpoint algorithm. The algorithm walks a quarter
+** of the ellipse; each row is drawn as spans once it is done, mirrored into
+** the other quarters. Outlines draw the pixels between the width of the row
+** and the row past it, so that steep parts stay connected
+**
+** @param e Ellipse
+** @param a Radius along x
+** @param b Radius along y
+*/
+static void __gl_ellipse(const GL_Ellipse* e, int32_t a, int32_t b)
+{
+    int32_t a2 = a * a, b2 = b * b;
+    int32_t x = 0, y = b;
+    int32_t px = 0, py = 2 * a2 * y;
+    // half-width of the last row drawn
+    int16_t last = -1;
+    // region 1: the slope is shallow, so x moves every step
+    int32_t p = b2 - (a2 * b) + (a2 / 4);
+    while (px < py)
+    {
+        ++x;
+        px += 2 * b2;
+        if (p < 0)
+            p += b2 + px;
+        else
+        {
+            __gl_ellipse_rows(e, y, x - 1, last + 1);
+            last = x - 1;
+            --y;
+            py -= 2 * a2;
+            p += b2 + px - py;
+        }
+    }
+    // region 2: the slope is steep, so y moves every step. The terms are
+    // large, but their sum is small; it comes out right as long as the math
+    // wraps around
+    p = (int32_t)(((uint32_t)b2 * ((x * x) + x)) + (b2 / 4)
+        + ((uint32_t)a2 * ((y - 1) * (y - 1))) - ((uint32_t)a2 * b2));
+    while (y >= 0)
+    {
+        __gl_ellipse_rows(e, y, x, (last < x) ? last + 1 : x);
+        last = x;
+        --y;
+        py -= 2 * a2;
+        if (p > 0)
+            p += a2 - py;
+        else
+        {
+            ++x;
+            px += 2 * b2;
+            p += a2 - py + px;
+        }
+    }
+}
+
+/*
+** Sets up an ellipse to draw
+**
+** @param e Ellipse to set up
+** @param ctr Center point
+** @param color Handle from gl_color_resolve()
+** @param fill True to fill the ellipse
+*/
+static void __gl_ellipse_init(GL_Ellipse* e, Point_2D ctr, gl_color_t color,
+    bool fill)
+{
+    e->cx = ctr.x;
+    e->cy = ctr.y;
+    e->color = color;
+    e->fill = fill;
+    e->arc = false;
+}
+
+/*
+** Steps down one side of a triangle, filling towards its long side
+**
+** @param top Upper end of the short side
+** @param bot Lower end of the short side
+** @param x_long x of the long side on the scanline of top, fixed point.
+**        Moved down to the scanline of bot
+** @param dx_long Change in x of the long side on each scanline
+** @param color Handle from gl_color_resolve()
+*/
+static void __gl_fill_tri_half(Point_2D top, Point_2D bot, int32_t* x_long,
+    int32_t dx_long, gl_color_t color)
+{
+    int16_t y = top.y;
+    int16_t y_end = bot.y;
+    if (y == y_end)
+        return;
+    int32_t x = GL_FIX(top.x);
+    int32_t dx = (GL_FIX(bot.x) - x) / (y_end - y);
+    // skip what is above the clip rectangle without drawing it
+    if (y < vga_clip.y0)
+    {
+        int16_t skip = ((y_end < vga_clip.y0) ? y_end : vga_clip.y0) - y;
+        x += dx * skip;
+        *x_long += dx_long * skip;
+        y += skip;
+    }
+    for (; y<y_end; ++y)
+    {
+        if (y >= vga_clip.y1)
+        {
+            *x_long += dx_long * (y_end - y);
+            return;
+        }
+        if (x < *x_long)
+            __gl_fill_span(y, x, *x_long, color);
+        else
+            __gl_fill_span(y, *x_long, x, color);
+        x += dx;
+        *x_long += dx_long;
+    }
+}
+
+/*
+** Shades a pixel of an anti-aliased line
+**
+** @param x Position along the line's major axis
+** @param y Position along the line's minor axis
+** @param steep True if the major axis is the screen's y axis
+** @param level Coverage of the pixel, out of GL_AA_LEVELS
+** @param ramp Ramp from the background to the line color
+*/
+static void __gl_aa_plot(int16_t x, int16_t y, bool steep, uint8_t level,
+    gl_ramp_t ramp)
+{
+    // nothing covered by only the background needs to be drawn
+    if (level > 0)
+        gl_put_pixel_h(steep ? PT2(y, x) : PT2(x, y), ramp + level);
+}
+
+/************************** User Functions ****************************/
+
+/***** Ellipse Draw Functions (driver-independent)   *****/
+
+/*
+** Draws the outline of an ellipse
+**
+** @param ctr Center point
+** @param rx Radius along x
+** @param ry Radius along y
+** @param color Color to draw
+*/
+void gl_draw_ellipse(Point_2D ctr, uint16_t rx, uint16_t ry, RGB_8 color)
+{
+    GL_Ellipse e;
+    __gl_ellipse_init(&e, ctr, gl_color_resolve(color), false);
+    __gl_ellipse(&e, rx, ry);
+    gl_color_release(e.color);
+}
+
+/*
+** Fills an ellipse
+**
+** @param ctr Center point
+** @param rx Radius along x
+** @param ry Radius along y
+** @param color Color to fill with
+*/
+void gl_fill_ellipse(Point_2D ctr, uint16_t rx, uint16_t ry, RGB_8 color)
+{
+    GL_Ellipse e;
+    __gl_ellipse_init(&e, ctr, gl_color_resolve(color), true);
+    __gl_ellipse(&e, rx, ry);
+    gl_color_release(e.color);
+}
+
+/*
+** Draws an arc of a circle, going clockwise from one direction to another.
+** Directions are given as points on the screen; the arc runs from the ray
+** through p0 to the ray through p1. Points in the same direction draw the
+** whole circle
+**
+** @param ctr Center point
+** @param r Radius
+** @param p0 Point the arc starts in the direction of
+** @param p1 Point the arc ends in the direction of
+** @param color Color to draw
+*/
+void gl_draw_arc(Point_2D ctr, uint16_t r, Point_2D p0, Point_2D p1,
+    RGB_8 color)
+{
+    GL_Ellipse e;
+    __gl_ellipse_init(&e, ctr, gl_color_resolve(color), false);
+    e.v0_x = (int32_t)p0.x - ctr.x;
+    e.v0_y = (int32_t)p0.y - ctr.y;
+    e.v1_x = (int32_t)p1.x - ctr.x;
+    e.v1_y = (int32_t)p1.y - ctr.y;
+    int32_t cross = (e.v0_x * e.v1_y) - (e.v0_y * e.v1_x);
+    int32_t dot = (e.v0_x * e.v1_x) + (e.v0_y * e.v1_y);
+    e.arc = (cross != 0) || (dot < 0);
+    e.wide = cross < 0;
+    __gl_ellipse(&e, r, r);
+    gl_color_release(e.color);
+}
+
+/***** Anti-aliased Line Functions (driver-independent)   *****/
+
+/*
+** Draws a 1 pixel wide anti-aliased line (Wu's algorithm)
+**
+** @param p0 Start point
+** @param p1 End point
+** @param fg Line color
+** @param bg Background color
+*/
+void gl_draw_line_aa(Point_2D p0, Point_2D p1, RGB_8 fg, RGB_8 bg)
+{
+    gl_ramp_t ramp = gl_ramp_resolve(bg, fg, GL_AA_LEVELS);
+    if (ramp == GL_RAMP_NONE)
+    {
+        gl_draw_line(p0, p1, fg);
+        return;
+    }
+    gl_draw_line_aa_h(p0, p1, ramp);
+    gl_ramp_release(ramp);
+}
+
+/*
+** Draws a 1 pixel wide anti-aliased line, using a ramp from the background to
+** the line color
+**
+** @param p0 Start point
+** @param p1 End point
+** @param ramp Ramp of GL_AA_LEVELS steps from gl_ramp_resolve()
+*/
+void gl_draw_line_aa_h(Point_2D p0, Point_2D p1, gl_ramp_t ramp)
+{
+    // end points are drawn solid
+    gl_put_pixel_h(p0, ramp + (GL_AA_LEVELS - 1));
+    gl_put_pixel_h(p1, ramp + (GL_AA_LEVELS - 1));
+    // steep lines are walked with x and y swapped, so that x is always the
+    // major axis and always goes forwards
+    int16_t dx = (int16_t)p1.x - (int16_t)p0.x;
+    int16_t dy = (int16_t)p1.y - (int16_t)p0.y;
+    bool steep = ((dy < 0) ? -dy : dy) > ((dx < 0) ? -dx : dx);
+    Point_2D tp;
+    if (steep)
+    {
+        p0 = PT2(p0.y, p0.x);
+        p1 = PT2(p1.y, p1.x);
+    }
+    if (p1.x < p0.x)
+    {
+        tp = p0; p0 = p1; p1 = tp;
+    }
+    dx = p1.x - p0.x;
+    dy = (int16_t)p1.y - (int16_t)p0.y;
+    int8_t step = 1;
+    if (dy < 0)
+    {
+        dy = -dy;
+        step = -1;
+    }
+    if (dx == 0)
+        return;
+    // the error is the fraction of a pixel the line has drifted along the
+    // minor axis; wrapping around means the next pixel has been reached.
+    // Diagonals come up just short of a whole pixel, which draws the same
+    uint32_t adj = ((uint32_t)dy << 16) / dx;
+    uint16_t err_adj = (adj > 0xFFFF) ? 0xFFFF : adj;
+    uint16_t err = 0;
+    int16_t y = p0.y;
+    for (int16_t x=p0.x + 1; x<(int16_t)p1.x; ++x)
+    {
+        uint16_t last = err;
+        err += err_adj;
+        if (err < last)
+            y += step;
+        // the farther pixel gets the fraction, the nearer one the rest
+        uint8_t w = err >> (16 - GL_AA_SHIFT);
+        __gl_aa_plot(x, y, steep, (GL_AA_LEVELS - 1) - w, ramp);
+        __gl_aa_plot(x, y + step, steep, w, ramp);
+    }
+}
+
+/***** Polygon Fill Functions (driver-independent)   *****/
+
+/*
+** Fills a polygon. The polygon may be concave or cross over itself; areas
+** inside an odd number of edges are filled. A pixel is filled if its
+** upper-left corner is inside the polygon, so polygons that share an edge
+** don't overlap. Corner coordinates are signed, so corners may lie left of or
+** above the screen. Polygons with more than GL_POLY_MAX corners are not drawn
+**
+** @param pts Corners of the polygon, in order. The last point connects back to
+**        the first
+** @param n Number of points
+** @param color Color to fill with
+*/
+void gl_fill_poly(const Point_2D* pts, uint16_t n, RGB_8 color)
+{
+    gl_color_t handle = gl_color_resolve(color);
+    gl_fill_poly_h(pts, n, handle);
+    gl_color_release(handle);
+}
+
+/*
+** Fills a polygon, using a color handle. Otherwise this is the same as
+** gl_fill_poly()
+**
+** @param pts Corners of the polygon, in order
+** @param n Number of points
+** @param color Handle from gl_color_resolve()
+*/
+void gl_fill_poly_h(const Point_2D* pts, uint16_t n, gl_color_t color)
+{
+    if ((n < 3) || (n > GL_POLY_MAX))
+        return;
+    if (n == 3)
+    {
+        gl_fill_tri_h(pts[0], pts[1], pts[2], color);
+        return;
+    }
+    // edge table, sorted on the top scanline of each edge. Flat edges never
+    // cover a scanline, so they are left out
+    GL_Edge edge[GL_POLY_MAX];
+    uint16_t edges = 0;
+    for (uint16_t i=0; i<n; ++i)
+    {
+        Point_2D a = pts[i];
+        Point_2D b = pts[(i + 1 == n) ? 0 : i + 1];
+        if (a.y == b.y)
+            continue;
+        if ((int16_t)a.y > (int16_t)b.y)
+        {
+            Point_2D tp = a;
+            a = b; b = tp;
+        }
+        GL_Edge add = {a.y, b.y, GL_FIX(a.x), 0};
+        add.dx = (GL_FIX(b.x) - add.x) / (add.y1 - add.y0);
+        uint16_t j = edges++;
+        for (; (j > 0) && (edge[j - 1].y0 > add.y0); --j)
+            edge[j] = edge[j - 1];
+        edge[j] = add;
+    }
+    if (edges == 0)
+        return;
+    int16_t y_end = edge[0].y1;
+    for (uint16_t i=1; i<edges; ++i)
+    {
+        if (edge[i].y1 > y_end)
+            y_end = edge[i].y1;
+    }
+    if (y_end > (int16_t)vga_clip.y1)
+        y_end = vga_clip.y1;
+    // active edge list, kept sorted on x
+    GL_Edge* active[GL_POLY_MAX];
+    uint16_t act = 0;
+    uint16_t next = 0;
+    int16_t y = edge[0].y0;
+    if (y < (int16_t)vga_clip.y0)
+        y = vga_clip.y0;
+    for (; y<y_end; ++y)
+    {
+        // drop edges that end above this scanline
+        uint16_t keep = 0;
+        for (uint16_t i=0; i<act; ++i)
+        {
+            if (active[i]->y1 > y)
+                active[keep++] = active[i];
+        }
+        act = keep;
+        // pick up edges that start on (or, when clipped, above) this scanline
+        for (; (next < edges) && (edge[next].y0 <= y); ++next)
+        {
+            GL_Edge* add = &edge[next];
+            if (add->y1 <= y)
+                continue;
+            add->x += add->dx * (y - add->y0);
+            active[act++] = add;
+        }
+        // edges only swap places where they cross, so the list is nearly
+        // sorted from the last scanline
+        for (uint16_t i=1; i<act; ++i)
+        {
+            GL_Edge* cur = active[i];
+            uint16_t j = i;
+            for (; (j > 0) && (active[j - 1]->x > cur->x); --j)
+                active[j] = active[j - 1];
+            active[j] = cur;
+        }
+        for (uint16_t i=0; (i + 1)<act; i+=2)
+            __gl_fill_span(y, active[i]->x, active[i + 1]->x, color);
+        for (uint16_t i=0; i<act; ++i)
+            active[i]->x += active[i]->dx;
+    }
+}
+
+/*
+** Fills a triangle. Triangles skip the edge lists of gl_fill_poly(); the left
+** and right edges are stepped down together. Like gl_fill_poly(), corner
+** coordinates are signed
+**
+** @param p0 First corner
+** @param p1 Second corner
+** @param p2 Third corner
+** @param color Color to fill with
+*/
+void gl_fill_tri(Point_2D p0, Point_2D p1, Point_2D p2, RGB_8 color)
+{
+    gl_color_t handle = gl_color_resolve(color);
+    gl_fill_tri_h(p0, p1, p2, handle);
+    gl_color_release(handle);
+}
+
+/*
+** Fills a triangle, using a color handle
+**
+** @param p0 First corner
+** @param p1 Second corner
+** @param p2 Third corner
+** @param color Handle from gl_color_resolve()
+*/
+void gl_fill_tri_h(Point_2D p0, Point_2D p1, Point_2D p2, gl_color_t color)
+{
+    // sort the corners from top to bottom
+    Point_2D tp;
+    if ((int16_t)p0.y > (int16_t)p1.y)
+    {
+        tp = p0; p0 = p1; p1 = tp;
+    }
+    if ((int16_t)p1.y > (int16_t)p2.y)
+    {
+        tp = p1; p1 = p2; p2 = tp;
+    }
+    if ((int16_t)p0.y > (int16_t)p1.y)
+    {
+        tp = p0; p0 = p1; p1 = tp;
+    }
+    if (p0.y == p2.y)
+        return;
+    // the long side runs from the top corner to the bottom one; the two short
+    // sides meet it at the middle corner
+    int32_t x_long = GL_FIX(p0.x);
+    int32_t dx_long = (GL_FIX(p2.x) - x_long)
+        / ((int16_t)p2.y - (int16_t)p0.y);
+    __gl_fill_tri_half(p0, p1, &x_long, dx_long, color);
+    __gl_fill_tri_half(p1, p2, &x_long, dx_long, color);
+}
@@ -0,0 +1,149 @@
+/*
+** File:    gl_shape.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Shapes for the graphics library. Shapes are broken down into
+**              horizontal spans, from the top of the shape down, and each
+**              span is handed to the driver as a single run
+*/
+#ifndef _GL_SHAPE_H_
+#define _GL_SHAPE_H_
+
+/** Headers    **/
+#include "../kern/gcc16.h"
+#include "../kern/types.h"
+#include "../gl/gl_lib.h"
+
+/** Macros     **/
+// circles are ellipses with the same radius on both axes
+#define gl_draw_circle(ctr, r, color)   gl_draw_ellipse(ctr, r, r, color)
+#define gl_fill_circle(ctr, r, color)   gl_fill_ellipse(ctr, r, r, color)
+
+// anti-aliased lines are shaded with a ramp of this many steps, from the
+// background (step 0) to the line color
+#define GL_AA_SHIFT     3
+#define GL_AA_LEVELS    (1 << GL_AA_SHIFT)
+
+// most corners a polygon fill takes; the edge lists are kept on the stack
+#define GL_POLY_MAX     16
+
+/** Globals    **/
+
+/** Structures **/
+
+/** Functions  **/
+
+/***** Ellipse Draw Functions (driver-independent)   *****/
+
+/*
+** Draws the outline of an ellipse. Each row of the outline is drawn as a
+** span, rather than pixel by pixel
+**
+** @param ctr Center point
+** @param rx Radius along x
+** @param ry Radius along y
+** @param color Color to draw
+*/
+void gl_draw_ellipse(Point_2D ctr, uint16_t rx, uint16_t ry, RGB_8 color);
+
+/*
+** Fills an ellipse
+**
+** @param ctr Center point
+** @param rx Radius along x
+** @param ry Radius along y
+** @param color Color to fill with
+*/
+void gl_fill_ellipse(Point_2D ctr, uint16_t rx, uint16_t ry, RGB_8 color);
+
+/*
+** Draws an arc of a circle, going clockwise from one direction to another.
+** Directions are given as points on the screen; the arc runs from the ray
+** through p0 to the ray through p1. Points in the same direction draw the
+** whole circle
+**
+** @param ctr Center point
+** @param r Radius
+** @param p0 Point the arc starts in the direction of
+** @param p1 Point the arc ends in the direction of
+** @param color Color to draw
+*/
+void gl_draw_arc(Point_2D ctr, uint16_t r, Point_2D p0, Point_2D p1,
+    RGB_8 color);
+
+/***** Anti-aliased Line Functions (driver-independent)   *****/
+
+/*
+** Draws a 1 pixel wide anti-aliased line (Wu's algorithm). Each step along the
+** line shades the two pixels it falls between by how much of the line covers
+** them. Coverage is a step in a palette ramp, so the screen is never read
+** back; the line should be drawn over the background it was shaded for. Falls
+** back on a plain line if the mode can't spare the ramp
+**
+** @param p0 Start point
+** @param p1 End point
+** @param fg Line color
+** @param bg Background color
+*/
+void gl_draw_line_aa(Point_2D p0, Point_2D p1, RGB_8 fg, RGB_8 bg);
+
+/*
+** Draws a 1 pixel wide anti-aliased line, using a ramp from the background to
+** the line color. Otherwise this is the same as gl_draw_line_aa()
+**
+** @param p0 Start point
+** @param p1 End point
+** @param ramp Ramp of GL_AA_LEVELS steps from gl_ramp_resolve()
+*/
+void gl_draw_line_aa_h(Point_2D p0, Point_2D p1, gl_ramp_t ramp);
+
+/***** Polygon Fill Functions (driver-independent)   *****/
+
+/*
+** Fills a polygon. The polygon may be concave or cross over itself; areas
+** inside an odd number of edges are filled. A pixel is filled if its
+** upper-left corner is inside the polygon, so polygons that share an edge
+** don't overlap. Corner coordinates are signed, so corners may lie left of or
+** above the screen. Polygons with more than GL_POLY_MAX corners are not drawn
+**
+** @param pts Corners of the polygon, in order. The last point connects back to
+**        the first
+** @param n Number of points
+** @param color Color to fill with
+*/
+void gl_fill_poly(const Point_2D* pts, uint16_t n, RGB_8 color);
+
+/*
+** Fills a polygon, using a color handle. Otherwise this is the same as
+** gl_fill_poly()
+**
+** @param pts Corners of the polygon, in order
+** @param n Number of points
+** @param color Handle from gl_color_resolve()
+*/
+void gl_fill_poly_h(const Point_2D* pts, uint16_t n, gl_color_t color);
+
+/*
+** Fills a triangle. Triangles skip the edge lists of gl_fill_poly(); the left
+** and right edges are stepped down together. Like gl_fill_poly(), corner
+** coordinates are signed
+**
+** @param p0 First corner
+** @param p1 Second corner
+** @param p2 Third corner
+** @param color Color to fill with
+*/
+void gl_fill_tri(Point_2D p0, Point_2D p1, Point_2D p2, RGB_8 color);
+
+/*
+** Fills a triangle, using a color handle
+**
+** @param p0 First corner
+** @param p1 Second corner
+** @param p2 Third corner
+** @param color Handle from gl_color_resolve()
+*/
+void gl_fill_tri_h(Point_2D p0, Point_2D p1, Point_2D p2, gl_color_t color);
+
+#endif
@@ -13,7 +13,9 @@
 #include "pane.h"
 
 #include "../kern/kio.h"
+#include "../kern/mem_map.h"
 #include "gl_lib.h"
+#include "tcache.h"
 
 // Common colors used in panes
 #define RGB_OFF_WHITE       RGB(230, 230, 230)
@@ -34,6 +36,10 @@
 
 // strf pattern used for options in a prompt menu
 #define OPT_PATTERN         "%D. - %s"
+// memory budget for rendered pane text; no more than MEM_TEXT_CACHE has room
+#define PANE_TCACHE_SIZE    32768
+// body text and prompt options, rendered once and drawn again with one blit
+#define PANE_TC             MEM_FAR(TCache, MEM_PANE_TCACHE)
 
 // screen dimensions
 static uint16_t fr_w;
@@ -45,41 +51,59 @@ static Point_2D pane_pad;
 // width boundary of the pane; keeps the text from going out of the window
 static uint16_t pane_w_bound;
 
-// theme color settings, set by user program or defaults to the HSC theme
-RGB_8 thm_b_pane;
-RGB_8 thm_f_pane;
-RGB_8 thm_b_title;
-RGB_8 thm_f_title;
-RGB_8 thm_text;
-RGB_8 thm_b_select;
-RGB_8 thm_f_select;
-RGB_8 thm_drop_shadow;
+// theme color settings, set by user program or defaults to the HSC theme.
+// These are resolved once per theme, so drawing a pane never looks them up
+static gl_color_t thm_b_pane;
+static gl_color_t thm_f_pane;
+static gl_color_t thm_b_title;
+static gl_color_t thm_f_title;
+static gl_color_t thm_text;
+static gl_color_t thm_b_select;
+static gl_color_t thm_f_select;
+static gl_color_t thm_drop_shadow;
+// gradients the screen background and title bar are filled with, or
+// GL_RAMP_NONE for flat fills in the colors above
+static gl_ramp_t thm_g_pane;
+static gl_ramp_t thm_g_title;
+// mode the theme colors were resolved in
+static uint16_t thm_mode = VGA_MODE_TEXT;
 
 /*
-** Draws background of a pane; standard across all panes
+** Draws background of a pane; standard across all panes. Drawing is left
+** clipped to the pane, so content can't spill over its edges; callers undo
+** this with gl_pop_clip() once the pane is done
 */
 static void __pane_draw_bg()
 {
     gl_clrscr();
     // clear screen with background color
-    gl_draw_rect_wh(PT2(0, 0), fr_w, fr_h, thm_b_pane);
-    // draw the pane on top of the background color
-    gl_draw_rect_wh(pane_pad, pane_wh.x, pane_wh.y, thm_f_pane);
-    // bump-map the screen borders because we want to look cool
-    // bottom drop shadow
-    gl_draw_rect_wh(
-        PT2(2 * pane_pad.x, fr_h - pane_pad.y),
-        fr_w - (3 * pane_pad.x),
-        pane_pad.y / 2,
-        thm_drop_shadow
-    );
-    // right-hand drop shadow
-    gl_draw_rect_wh(
-        PT2(fr_w - pane_pad.x, 2 * pane_pad.y),
-        pane_pad.x / 2,
-        fr_h - (3 * pane_pad.y) + (pane_pad.y / 2),
-        thm_drop_shadow
-    );
+    if (thm_g_pane == GL_RAMP_NONE)
+        gl_draw_rect_wh_h(PT2(0, 0), fr_w, fr_h, thm_b_pane);
+    else
+        gl_draw_gradient_rect_h(PT2(0, 0), fr_w, fr_h, thm_g_pane,
+            GL_GRAD_STEPS, false);
+    GL_Rect_H bg[] =
+    {
+        // draw the pane on top of the background color
+        {pane_pad, pane_wh.x, pane_wh.y, thm_f_pane},
+        // bump-map the screen borders because we want to look cool
+        // bottom drop shadow
+        {
+            PT2(2 * pane_pad.x, fr_h - pane_pad.y),
+            fr_w - (3 * pane_pad.x),
+            pane_pad.y / 2,
+            thm_drop_shadow
+        },
+        // right-hand drop shadow
+        {
+            PT2(fr_w - pane_pad.x, 2 * pane_pad.y),
+            pane_pad.x / 2,
+            fr_h - (3 * pane_pad.y) + (pane_pad.y / 2),
+            thm_drop_shadow
+        },
+    };
+    gl_draw_rects_h(bg, sizeof(bg) / sizeof(bg[0]));
+    gl_push_clip(pane_pad, pane_wh.x, pane_wh.y);
 }
 
 /*
@@ -92,26 +116,29 @@ static uint16_t __pane_draw_top_title(char* title)
 {
     if (title == NULL)
         return 0;
-    Point_2D ul = pane_pad;
-    Point_2D bb;
-    gl_draw_str_bb(ul, title, DEFAULT_FONT_SCALE, pane_w_bound, &bb);
+    GL_Text txt;
+    gl_text_lay(&txt, pane_pad, title, DEFAULT_FONT_SCALE, pane_w_bound);
     // draw a background rectangle around the title
-    gl_draw_rect_wh(pane_pad, pane_wh.x, bb.y, thm_b_title);
+    if (thm_g_title == GL_RAMP_NONE)
+        gl_draw_rect_wh_h(pane_pad, pane_wh.x, txt.bb.y, thm_b_title);
+    else
+        gl_draw_gradient_rect_h(pane_pad, pane_wh.x, txt.bb.y, thm_g_title,
+            GL_GRAD_STEPS, true);
     // draw the title to the screen
-    gl_draw_str_scale(ul, thm_f_title, thm_f_title, title,
-        DEFAULT_FONT_SCALE, pane_w_bound);
-    return bb.y;
+    gl_set_colors(thm_f_title, thm_f_title);
+    gl_draw_text_h(&txt, pane_pad);
+    return txt.bb.y;
 }
 
 /*
 ** Initialize a graphical mode for pane-based programs
 **
-** @param mode Graphics mode to select
+** @param mode Graphics mode to select, see gl_enter()
 */
 void pane_enter(uint8_t mode)
 {
     // start graphics mode, if needed
-    if (gl_get_mode() != mode)
+    if (gl_get_mode() != (mode & VGA_MODE_MASK))
         gl_enter(mode);
     // calculate common values, now that we have some info on the display mode
     // size of the view window
@@ -125,6 +152,7 @@ void pane_enter(uint8_t mode)
     pane_wh.y = fr_h - (2 * pane_pad.y);
     // text boundary; forces word wrap
     pane_w_bound = fr_w - pane_pad.y;
+    tcache_init(PANE_TC, MEM_FAR(uint8_t, MEM_TEXT_CACHE), PANE_TCACHE_SIZE);
     // use theme defaults
     pane_set_theme(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 }
@@ -148,14 +176,43 @@ void pane_set_theme(
     RGB_8* b_select, RGB_8* f_select,
     RGB_8* text,     RGB_8* drop_shadow)
 {
-    thm_b_pane      = (b_pane == NULL)      ? RGB_HSC           : *b_pane;
-    thm_f_pane      = (f_pane == NULL)      ? RGB_OFF_WHITE     : *f_pane;
-    thm_b_title     = (b_title == NULL)     ? RGB_PANE_TITLE    : *b_title;
-    thm_f_title     = (f_title == NULL)     ? RGB_OFF_WHITE     : *f_title;
-    thm_b_select    = (b_select == NULL)    ? RGB_HSC           : *b_select;
-    thm_f_select    = (f_select == NULL)    ? RGB_OFF_WHITE     : *f_select;
-    thm_text        = (text == NULL)        ? RGB_HSC           : *text;
-    thm_drop_shadow = (drop_shadow == NULL) ? RGB_DROP_SHADOW   : *drop_shadow;
+    // handles from an earlier mode are already gone with that mode
+    if (thm_mode == gl_get_mode())
+    {
+        gl_color_release(thm_b_pane);
+        gl_color_release(thm_f_pane);
+        gl_color_release(thm_b_title);
+        gl_color_release(thm_f_title);
+        gl_color_release(thm_b_select);
+        gl_color_release(thm_f_select);
+        gl_color_release(thm_text);
+        gl_color_release(thm_drop_shadow);
+        gl_ramp_release(thm_g_pane);
+        gl_ramp_release(thm_g_title);
+    }
+    thm_mode = gl_get_mode();
+    RGB_8 c_pane = (b_pane == NULL) ? RGB_HSC : *b_pane;
+    RGB_8 c_title = (b_title == NULL) ? RGB_PANE_TITLE : *b_title;
+    RGB_8 c_shadow = (drop_shadow == NULL) ? RGB_DROP_SHADOW : *drop_shadow;
+    thm_b_pane      = gl_color_resolve(c_pane);
+    thm_f_pane      = gl_color_resolve(
+        (f_pane == NULL)      ? RGB_OFF_WHITE     : *f_pane);
+    thm_b_title     = gl_color_resolve(c_title);
+    thm_f_title     = gl_color_resolve(
+        (f_title == NULL)     ? RGB_OFF_WHITE     : *f_title);
+    thm_b_select    = gl_color_resolve(
+        (b_select == NULL)    ? RGB_HSC           : *b_select);
+    thm_f_select    = gl_color_resolve(
+        (f_select == NULL)    ? RGB_OFF_WHITE     : *f_select);
+    thm_text        = gl_color_resolve(
+        (text == NULL)        ? RGB_HSC           : *text);
+    thm_drop_shadow = gl_color_resolve(c_shadow);
+    // the background darkens towards the bottom of the screen and the title
+    // bar lightens towards the background on its right
+    thm_g_pane      = gl_ramp_resolve(c_pane,
+        vga_RGB_8_step(c_pane, c_shadow, 1, 3), GL_GRAD_STEPS);
+    thm_g_title     = gl_ramp_resolve(c_title,
+        vga_RGB_8_step(c_title, c_pane, 1, 3), GL_GRAD_STEPS);
 }
 
 /*
@@ -169,37 +226,36 @@ void pane_draw_title(char* title, char* sub)
     __pane_draw_bg();
     // center the title text and automatically pick the largest font size that
     // will fit in that region without word wrapping, if possible
-    uint8_t title_scale = DEFAULT_FONT_SCALE;
     Point_2D title_ul = pane_pad;
-    Point_2D title_bb;
-    // first try to find the best-fitting scale, horizontally
-    for (uint8_t s=MAX_FONT_SCALE; s>=title_scale; --s)
+    GL_Text title_txt;
+    gl_text_lay(&title_txt, title_ul, title, DEFAULT_FONT_SCALE, pane_w_bound);
+    // then try larger scales with the same lines, until one fits and is of a
+    // reasonable height. The default scale always keeps the lines
+    for (uint8_t s=MAX_FONT_SCALE; s>=DEFAULT_FONT_SCALE; --s)
     {
-        gl_draw_str_bb(title_ul, title, s, pane_w_bound, &title_bb);
-        // make sure that the text will fit and is of a reasonable height
-        if ((title_bb.x < pane_wh.x) && (title_bb.y <= (pane_wh.y / 4)))
-        {
-            title_scale = s;
+        if (gl_text_rescale(&title_txt, title_ul, s, pane_w_bound)
+            && (title_txt.bb.x < pane_wh.x)
+            && (title_txt.bb.y <= (pane_wh.y / 4)))
             break;
-        }
     }
     // then "center" the title on the pane, in both directions
-    title_ul.x = (title_ul.x + pane_wh.x - title_bb.x) / 2;
-    title_ul.y = (title_ul.y + pane_wh.y - title_bb.y) / 2;
+    title_ul.x = (title_ul.x + pane_wh.x - title_txt.bb.x) / 2;
+    title_ul.y = (title_ul.y + pane_wh.y - title_txt.bb.y) / 2;
     // actually draw the title to the screen
-    gl_draw_str_scale(title_ul, thm_text, thm_text, title, title_scale,
-        pane_w_bound);
+    gl_set_colors(thm_text, thm_text);
+    gl_draw_text_h(&title_txt, title_ul);
 
     // subtitle goes underneath the title, centered
     Point_2D sub_ul = pane_pad;
-    Point_2D sub_bb;
-    gl_draw_str_bb(sub_ul, sub, DEFAULT_FONT_SCALE, pane_w_bound, &sub_bb);
+    GL_Text sub_txt;
+    gl_text_lay(&sub_txt, sub_ul, sub, DEFAULT_FONT_SCALE, pane_w_bound);
     // center the subtitle
-    sub_ul.x = (sub_ul.x + pane_wh.x - sub_bb.x) / 2;
+    sub_ul.x = (sub_ul.x + pane_wh.x - sub_txt.bb.x) / 2;
     // put the subtitle under the title
-    sub_ul.y = title_ul.y + title_bb.y + pane_pad.y;
-    gl_draw_str_scale(sub_ul, thm_text, thm_text, sub, DEFAULT_FONT_SCALE,
-        pane_w_bound);
+    sub_ul.y = title_ul.y + title_txt.bb.y + pane_pad.y;
+    gl_draw_text_h(&sub_txt, sub_ul);
+    gl_pop_clip();
+    gl_present();
 }
 
 /*
@@ -215,8 +271,11 @@ void pane_draw_title_text(char* title, char* text)
     uint16_t title_h = __pane_draw_top_title(title);
 
     // draw text under the title
-    gl_draw_str_scale(PT2(pane_pad.x, title_h + pane_pad.y),
-        thm_text, thm_text, text, DEFAULT_FONT_SCALE, pane_w_bound);
+    gl_set_colors(thm_text, thm_text);
+    tcache_draw(PANE_TC, PT2(pane_pad.x, title_h + pane_pad.y), text,
+        DEFAULT_FONT_SCALE, pane_w_bound, NULL);
+    gl_pop_clip();
+    gl_present();
 }
 
 /*
@@ -249,6 +308,8 @@ void pane_draw_title_img(char* title, uint8_t fid)
         }
     }
     gl_draw_img_center_scale(fid, img_scale);
+    gl_pop_clip();
+    gl_present();
 }
 
 /*
@@ -277,8 +338,11 @@ void pane_draw_title_img_text(char* title, uint8_t fid, char* text)
 
     // set the text to the left, right-bounded by the left of the image, with
     // some padding
-    gl_draw_str_scale(PT2(pane_pad.x, title_h + pane_pad.y),
-        thm_text, thm_text, text, DEFAULT_FONT_SCALE, img_ul.x - pane_pad.x);
+    gl_set_colors(thm_text, thm_text);
+    tcache_draw(PANE_TC, PT2(pane_pad.x, title_h + pane_pad.y), text,
+        DEFAULT_FONT_SCALE, img_ul.x - pane_pad.x, NULL);
+    gl_pop_clip();
+    gl_present();
 }
 
 /*
@@ -307,28 +371,22 @@ uint8_t pane_draw_prompt(char* prompt, uint8_t optc, char* optv[])
             Point_2D opt_ul = {pane_pad.x, prompt_h + pane_pad.y};
             for(uint8_t i=0; i<optc; ++i)
             {
-                Point_2D bb;
-                // calculate the size of the string to be printed
-                gl_draw_strf_bb(opt_ul, OPT_PATTERN, DEFAULT_FONT_SCALE,
-                    pane_w_bound, &bb, &i, optv[i]);
+                // format the option; it is only rendered the first time
+                uint16_t size = kio_sprintf_len(OPT_PATTERN, &i, optv[i]);
+                char buff[size];
+                kio_sprintf(OPT_PATTERN, buff, &i, optv[i]);
                 // selectively draw the selected text
                 if (opt == i)
-                {
-                    gl_draw_strf_scale(opt_ul, thm_b_select, thm_f_select,
-                        OPT_PATTERN, DEFAULT_FONT_SCALE, pane_w_bound, &i,
-                        optv[i]
-                    );
-                }
+                    gl_set_colors(thm_f_select, thm_b_select);
                 else
-                {
-                    gl_draw_strf_scale(opt_ul, thm_f_pane, thm_text,
-                        OPT_PATTERN, DEFAULT_FONT_SCALE, pane_w_bound, &i,
-                        optv[i]
-                    );
-                }
+                    gl_set_colors(thm_text, thm_f_pane);
+                Point_2D bb;
+                tcache_draw(PANE_TC, opt_ul, buff, DEFAULT_FONT_SCALE,
+                    pane_w_bound, &bb);
                 // advance the cursor
                 opt_ul.y += pane_pad.y + bb.y;
             }
+            gl_present();
         }
         // record the old option for redrawing purposes
         old_opt = opt;
@@ -358,6 +416,7 @@ uint8_t pane_draw_prompt(char* prompt, uint8_t optc, char* optv[])
     } while(((char)ch != '\r') && ((char)ch != '\n'));
 
     // prompts clean-up after themselves
+    gl_pop_clip();
     gl_clrscr();
     return opt;
 }
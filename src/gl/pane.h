@@ -27,7 +27,7 @@
 /*
 ** Initialize a graphical mode for pane-based programs
 **
-** @param mode Graphics mode to select
+** @param mode Graphics mode to select, see gl_enter()
 */
 void pane_enter(uint8_t mode);
 
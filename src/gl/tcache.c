@@ -0,0 +1,237 @@
+/*
+** File:    tcache.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Cache of rendered text. Strings are laid out and rendered to a
+**              1 bit-per-pixel mask once; drawing the same string again is a
+**              single blit. When the cache's memory runs out, the strings
+**              drawn least recently are thrown out
+*/
+
+/** Headers    **/
+#include "../kern/gcc16.h"
+#include "tcache.h"
+
+#include "../kern/kio.h"
+#include "see_font.h"
+
+/** Macros     **/
+// 32-bit FNV-1a hash constants
+#define TCACHE_FNV_BASIS    2166136261UL
+#define TCACHE_FNV_PRIME    16777619UL
+
+// bytes in each row of a mask
+#define TCACHE_STRIDE(ent)  (((ent)->bb.x + 7) / 8)
+
+/************************** Internal Functions *************************/
+
+/*
+** Hashes a string along with the settings that change its layout
+**
+** @param str String to hash
+** @param scale Font scale factor
+** @param w_avail Width the text is wrapped to, from its left edge
+** @return Hash value
+*/
+static uint32_t __tcache_hash(const char* str, uint8_t scale,
+    uint16_t w_avail)
+{
+    uint32_t hash = TCACHE_FNV_BASIS;
+    for (; *str != '\0'; ++str)
+    {
+        hash ^= (uint8_t)*str;
+        hash *= TCACHE_FNV_PRIME;
+    }
+    hash ^= scale;
+    hash *= TCACHE_FNV_PRIME;
+    hash ^= w_avail;
+    hash *= TCACHE_FNV_PRIME;
+    return hash;
+}
+
+/*
+** Throws out the string drawn least recently. The masks after it are moved
+** down over it, so that the free memory stays in one piece
+**
+** @param tc Cache, with at least one entry
+*/
+static void __tcache_evict(TCache* tc)
+{
+    uint8_t lru = 0;
+    for (uint8_t i=1; i<tc->cnt; ++i)
+    {
+        if (tc->ent[i].used < tc->ent[lru].used)
+            lru = i;
+    }
+    uint32_t size = tc->ent[lru].size;
+    uint8_t* dst = tc->mem + tc->ent[lru].off;
+    const uint8_t* src = dst + size;
+    for (uint32_t n=tc->top - (tc->ent[lru].off + size); n; --n)
+        *dst++ = *src++;
+    tc->top -= size;
+    for (uint8_t i=lru + 1; i<tc->cnt; ++i)
+    {
+        tc->ent[i - 1] = tc->ent[i];
+        tc->ent[i - 1].off -= size;
+    }
+    --tc->cnt;
+}
+
+/*
+** Sets a run of bits in a mask row
+**
+** @param row Mask row
+** @param x First bit to set, counting from the most significant bit
+** @param n Number of bits to set
+*/
+static void __tcache_set_bits(uint8_t* row, uint16_t x, uint16_t n)
+{
+    for (; n; --n, ++x)
+        row[x >> 3] |= 0x80 >> (x & 7);
+}
+
+/*
+** Renders laid out text to a mask, the same way gl_draw_text_h() would draw it
+**
+** @param txt Laid out text
+** @param mask Mask to render to, the size of the text's bounding box
+** @param stride Number of bytes in each mask row
+*/
+static void __tcache_render(const GL_Text* txt, uint8_t* mask,
+    uint16_t stride)
+{
+    uint8_t scale = txt->scale;
+    uint16_t cell_w = (scale * SEE_FONT_WIDTH) + (2 * SEE_FONT_PAD_HORZ);
+    uint16_t cell_h = (scale * SEE_FONT_HEIGHT) + (2 * SEE_FONT_PAD_VERT);
+    for (uint32_t n=(uint32_t)stride * txt->bb.y, i=0; i<n; ++i)
+        mask[i] = 0;
+    for (uint8_t i=0; i<txt->cnt; ++i)
+    {
+        const char* str = txt->str + txt->line[i].start;
+        uint16_t y0 = (i * cell_h) + SEE_FONT_PAD_VERT;
+        for (uint16_t j=0; j<txt->line[i].len; ++j)
+        {
+            uint8_t ch = str[j];
+            // characters the font doesn't have are blank
+            if ((ch < SEE_FONT_START_CH)
+                || (ch >= (SEE_FONT_START_CH + SEE_FONT_NUM_CH)))
+                continue;
+            const uint8_t* glyph = see_font_tbl[ch - SEE_FONT_START_CH];
+            uint16_t x0 = (j * cell_w) + SEE_FONT_PAD_HORZ;
+            // each font pixel becomes a scale x scale block of set bits
+            for (uint16_t r=0; r<(scale * SEE_FONT_HEIGHT); ++r)
+            {
+                uint8_t row_map = glyph[r / scale];
+                uint8_t* row = mask + ((y0 + r) * stride);
+                for (uint8_t c=0; row_map; ++c, row_map <<= 1)
+                {
+                    if (row_map & 0x80)
+                        __tcache_set_bits(row, x0 + (c * scale), scale);
+                }
+            }
+        }
+    }
+}
+
+/************************** User Functions ****************************/
+
+/*
+** Sets up a text cache
+**
+** @param tc Cache to set up
+** @param mem Memory to keep rendered text in
+** @param size Size of mem, in bytes. This is the budget for the cache
+*/
+void tcache_init(TCache* tc, uint8_t* mem, uint32_t size)
+{
+    tc->mem = mem;
+    tc->size = size;
+    tc->tick = 0;
+    tcache_clear(tc);
+}
+
+/*
+** Throws out everything in a text cache
+**
+** @param tc Cache
+*/
+void tcache_clear(TCache* tc)
+{
+    tc->top = 0;
+    tc->cnt = 0;
+}
+
+/*
+** Draws a string in the context colors set by gl_set_colors(), the same way
+** gl_draw_str_scale_h() does. The string is rendered into the cache the first
+** time; after that, it is drawn with a single blit. An opaque background
+** fills the whole bounding box of the text
+**
+** @param tc Cache
+** @param ul Upper-left starting point
+** @param str String to draw
+** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
+** @param w_bound Right-handed width to bound the text to. This is the maximum
+**        width value that can be drawn. After this word-wrapping is enforced
+** @param bb Where to store the width and height of the text, or NULL
+*/
+void tcache_draw(TCache* tc, Point_2D ul, char* str, uint8_t scale,
+    uint16_t w_bound, Point_2D* bb)
+{
+    // enforce the same limit on font scaling as the layout does
+    if ((scale < 1) || (scale > 127))
+        scale = 1;
+    // only the width left of the boundary changes where the text wraps
+    uint16_t w_avail = (w_bound > ul.x) ? w_bound - ul.x : 0;
+    uint32_t hash = __tcache_hash(str, scale, w_avail);
+    TCache_Ent* ent = NULL;
+    for (uint8_t i=0; i<tc->cnt; ++i)
+    {
+        TCache_Ent* cmp = &tc->ent[i];
+        if ((cmp->hash == hash) && (cmp->scale == scale)
+            && (cmp->w_avail == w_avail)
+            && kio_strcmp((const char*)(tc->mem + cmp->off
+                + (TCACHE_STRIDE(cmp) * cmp->bb.y)), str))
+        {
+            ent = cmp;
+            break;
+        }
+    }
+    if (ent == NULL)
+    {
+        GL_Text txt;
+        gl_text_lay(&txt, ul, str, scale, w_bound);
+        uint16_t stride = (txt.bb.x + 7) / 8;
+        uint32_t mask_size = (uint32_t)stride * txt.bb.y;
+        uint16_t str_len = kio_strlen(str) + 1;
+        if ((mask_size + str_len) > tc->size)
+        {
+            // would never fit, so it is drawn without the cache
+            gl_draw_text_h(&txt, ul);
+            if (bb != NULL)
+                *bb = txt.bb;
+            return;
+        }
+        while ((tc->cnt == TCACHE_ENTS)
+            || ((tc->top + mask_size + str_len) > tc->size))
+            __tcache_evict(tc);
+        ent = &tc->ent[tc->cnt++];
+        ent->hash = hash;
+        ent->off = tc->top;
+        ent->size = mask_size + str_len;
+        ent->bb = txt.bb;
+        ent->scale = scale;
+        ent->w_avail = w_avail;
+        tc->top += ent->size;
+        __tcache_render(&txt, tc->mem + ent->off, stride);
+        char* dst_str = (char*)(tc->mem + ent->off + mask_size);
+        for (uint16_t i=0; i<str_len; ++i)
+            dst_str[i] = str[i];
+    }
+    ent->used = ++tc->tick;
+    gl_draw_mask_h(ul, ent->bb.x, ent->bb.y, tc->mem + ent->off,
+        TCACHE_STRIDE(ent));
+    if (bb != NULL)
+        *bb = ent->bb;
+}
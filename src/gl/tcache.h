@@ -0,0 +1,93 @@
+/*
+** File:    tcache.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Cache of rendered text. Strings are laid out and rendered to a
+**              1 bit-per-pixel mask once; drawing the same string again is a
+**              single blit. When the cache's memory runs out, the strings
+**              drawn least recently are thrown out
+*/
+#ifndef _TCACHE_H_
+#define _TCACHE_H_
+
+/** Headers    **/
+#include "../kern/gcc16.h"
+#include "../kern/types.h"
+#include "../gl/gl_lib.h"
+
+/** Macros     **/
+// most strings a cache holds at once
+#define TCACHE_ENTS     16
+
+/** Globals    **/
+
+/** Structures **/
+
+// rendered string, see tcache_draw()
+typedef struct TCache_Ent
+{
+    // hash of the string and everything that changes its layout
+    uint32_t hash;
+    // offset of the mask in the cache's memory; a copy of the string follows
+    uint32_t off;
+    // bytes taken up by the mask and the string
+    uint32_t size;
+    // size of the text on the screen, which is the size of the mask
+    Point_2D bb;
+    uint8_t scale;
+    // width the text was wrapped to, from its left edge
+    uint16_t w_avail;
+    // tick of the last time this was drawn
+    uint32_t used;
+} TCache_Ent;
+
+// text cache, see tcache_init()
+typedef struct TCache
+{
+    // memory the masks are kept in and how much of it is in use. Masks are
+    // packed in the order of the entries
+    uint8_t* mem;
+    uint32_t size;
+    uint32_t top;
+    uint32_t tick;
+    uint8_t cnt;
+    TCache_Ent ent[TCACHE_ENTS];
+} TCache;
+
+/** Functions  **/
+
+/*
+** Sets up a text cache
+**
+** @param tc Cache to set up
+** @param mem Memory to keep rendered text in
+** @param size Size of mem, in bytes. This is the budget for the cache
+*/
+void tcache_init(TCache* tc, uint8_t* mem, uint32_t size);
+
+/*
+** Throws out everything in a text cache
+**
+** @param tc Cache
+*/
+void tcache_clear(TCache* tc);
+
+/*
+** Draws a string in the context colors set by gl_set_colors(), the same way
+** gl_draw_str_scale_h() does. The string is rendered into the cache the first
+** time; after that, it is drawn with a single blit. An opaque background
+** fills the whole bounding box of the text
+**
+** @param tc Cache
+** @param ul Upper-left starting point
+** @param str String to draw
+** @param scale Font scale factor (Ex: scale=2: 1 font pixel -> 4 real pixels)
+** @param w_bound Right-handed width to bound the text to. This is the maximum
+**        width value that can be drawn. After this word-wrapping is enforced
+** @param bb Where to store the width and height of the text, or NULL
+*/
+void tcache_draw(TCache* tc, Point_2D ul, char* str, uint8_t scale,
+    uint16_t w_bound, Point_2D* bb);
+
+#endif
@@ -35,3 +35,29 @@ void _outb(uint16_t port, uint8_t val)
 {
     __asm__ __volatile__( "outb %0, %1" : : "a"(val), "Nd"(port));
 }
+
+/*
+** Port I/O: Input Word
+**
+** @param port Comm port
+*/
+uint16_t _inw(uint16_t port)
+{
+    uint16_t val;
+    __asm__ __volatile__("inw %1, %0"
+        : "=a"(val)
+        : "Nd"(port)
+    );
+    return val;
+}
+
+/*
+** Port I/O: Output Word
+**
+** @param port Comm port
+** @param val Value to emit
+*/
+void _outw(uint16_t port, uint16_t val)
+{
+    __asm__ __volatile__( "outw %0, %1" : : "a"(val), "Nd"(port));
+}
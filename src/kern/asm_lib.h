@@ -35,4 +35,19 @@ uint8_t _inb(uint16_t port);
 */
 void _outb(uint16_t port, uint8_t val);
 
+/*
+** Port I/O: Input Word
+**
+** @param port Comm port
+*/
+uint16_t _inw(uint16_t port);
+
+/*
+** Port I/O: Output Word
+**
+** @param port Comm port
+** @param val Value to emit
+*/
+void _outw(uint16_t port, uint16_t val);
+
 #endif
@@ -64,12 +64,17 @@ __drive_reset:
     jc      __drive_reset       # if failure (EFLAGS carry bit set), try again
 
 __drive_read:
-    movw    $0x7E00, %bx        # load the OS after the bootloader
+    # The image is read into a staging area (0x10000) and copied into place
+    # from there. The kernel runs right up to 0x10000 and the user programs
+    # that sit past it in the image go into low memory. Reading straight to
+    # 0x7E00 would cross a 64kb boundary, which the floppy DMA can't do.
+    movw    $0x1000, %ax
+    movw    %ax, %es
+    xorw    %bx, %bx
 
     movb    $2,  %ah            # INT13h read function 
-    movb    $64, %al            # load 64 sectors (512-bytes each) all at once
-                                # this should be than enough sectors the OS
-                                # at time of writing is about ~46 sectors long
+    movb    $_LOAD_SECTORS, %al # load the whole image all at once; the
+                                # linker works out how many sectors that is
     movb    $0,  %ch            # cylinder 0
     movb    $2,  %cl            # sector 2
     movb    $0,  %dh            # head 0
@@ -82,10 +87,34 @@ __drive_read:
                                 # SeeGOL won't load properly...if at all.
                                 # 
 
+    # copy the kernel and then the low programs out of the staging area
+    cld
+    movw    %es, %ax            # %ds = 0x1000, %es = 0 for the copies
+    movw    %ax, %ds
+    xorw    %ax, %ax
+    movw    %ax, %es
+    xorw    %si, %si
+    movw    $0x7E00, %di
+    movw    $(0x10000 - 0x7E00), %cx
+    rep movsb
+    movw    $_LOW_BEGIN, %di    # %si is now at the low programs
+    movw    $_LOW_SIZE, %cx
+    rep movsb
+    movw    %ax, %ds
+
     movb    $'L',  %al          # L for loading (floppy loaded)
     movb    $0x0E, %ah
     int     $0x10
 
+    # zero-out uninitialized data (.bss lives below the boot sector and is not
+    # part of the image, so there is no guarantee of what is there)
+    movw    $_BSS_BEGIN, %di
+    movw    $_BSS_END, %cx
+    subw    %di, %cx
+    xorb    %al, %al
+    cld
+    rep stosb
+
     call    main                # jump to the start of the kernel code
 
 boot_extra:
@@ -0,0 +1,35 @@
+/*
+** File:    fix_sin_tbl.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Quarter-wave sine table, generated by tools/fix_sin_tbl.py.
+**              Do not edit by hand. Only fixed.c should include this
+*/
+#ifndef _FIX_SIN_TBL_H_
+#define _FIX_SIN_TBL_H_
+
+/** Headers    **/
+#include "gcc16.h"
+#include "types.h"
+
+/** Macros     **/
+// steps in a quarter turn, as a power of 2
+#define FIX_SIN_TBL_BITS    6
+
+/** Globals    **/
+// sin(0) through sin(90), unsigned 0.16 fixed point
+static const uint16_t fix_sin_tbl[(1 << FIX_SIN_TBL_BITS) + 1] =
+{
+    0x0000, 0x0648, 0x0C90, 0x12D5, 0x1918, 0x1F56, 0x2590, 0x2BC4,
+    0x31F1, 0x3817, 0x3E34, 0x4447, 0x4A50, 0x504D, 0x563E, 0x5C22,
+    0x61F8, 0x67BE, 0x6D74, 0x731A, 0x78AD, 0x7E2F, 0x839C, 0x88F6,
+    0x8E3A, 0x9368, 0x9880, 0x9D80, 0xA268, 0xA736, 0xABEB, 0xB086,
+    0xB505, 0xB968, 0xBDAF, 0xC1D8, 0xC5E4, 0xC9D1, 0xCD9F, 0xD14D,
+    0xD4DB, 0xD848, 0xDB94, 0xDEBE, 0xE1C6, 0xE4AA, 0xE76C, 0xEA0A,
+    0xEC83, 0xEED9, 0xF109, 0xF314, 0xF4FA, 0xF6BA, 0xF854, 0xF9C8,
+    0xFB15, 0xFC3B, 0xFD3B, 0xFE13, 0xFEC4, 0xFF4E, 0xFFB1, 0xFFEC,
+    0xFFFF
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+** File:    fixed.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Fixed point math library. There is no FPU to rely on (and no
+**              room for a soft float library), so fractions are kept in
+**              integers: 16.16 for general math and 8.8 where 16 bits have
+**              to do. Angles are binary; a full turn is 65536, so they wrap
+**              around on their own
+*/
+
+/** Headers    **/
+#include "gcc16.h"
+#include "fixed.h"
+#include "fix_sin_tbl.h"
+
+/** Macros     **/
+// angle bits between sine table entries, which are interpolated across
+#define FIX_SIN_FRAC_BITS   (14 - FIX_SIN_TBL_BITS)
+
+// atan(t) is close to (pi/4)t + 0.273t(1 - t) radians for t in [0, 1]. This
+// is the second term's factor, in binary angle units
+#define FIX_ATAN_K          2847
+
+/*
+** Multiplies two 16.16 numbers
+**
+** @param a First factor
+** @param b Second factor
+** @return Product, rounded down
+*/
+fix16_t fix_mul(fix16_t a, fix16_t b)
+{
+    return (fix16_t)(((int64_t)a * b) >> FIX16_SHIFT);
+}
+
+/*
+** Divides two 16.16 numbers
+**
+** @param a Dividend
+** @param b Divisor
+** @return Quotient, rounded towards 0. Quotients that don't fit (including
+**         anything divided by 0) are clamped to the largest value of the
+**         right sign
+*/
+fix16_t fix_div(fix16_t a, fix16_t b)
+{
+    uint32_t ua = (a < 0) ? -(uint32_t)a : (uint32_t)a;
+    uint32_t ub = (b < 0) ? -(uint32_t)b : (uint32_t)b;
+    // the CPU faults on quotients that don't fit, so catch them first
+    if ((ua >> (31 - FIX16_SHIFT)) >= ub)
+        return ((a < 0) != (b < 0)) ? (-0x7FFFFFFFL - 1) : 0x7FFFFFFFL;
+    // a 64-bit divide would pull in libgcc; the CPU can do it in one go
+    fix16_t q, r;
+    __asm__("idivl %4"
+        : "=a"(q), "=d"(r)
+        : "a"((uint32_t)a << FIX16_SHIFT), "d"(a >> (32 - FIX16_SHIFT)),
+        "rm"(b)
+        : "cc");
+    return q;
+}
+
+/*
+** Sine of an angle. A quarter-wave table is read and interpolated between
+** entries
+**
+** @param a Angle
+** @return Sine, 16.16
+*/
+fix16_t fix_sin(fix_angle_t a)
+{
+    uint16_t pos = a & (FIX_ANGLE_90 - 1);
+    // the second and fourth quarters run backwards through the table
+    if (a & FIX_ANGLE_90)
+        pos = FIX_ANGLE_90 - pos;
+    uint8_t idx = pos >> FIX_SIN_FRAC_BITS;
+    uint16_t frac = pos & ((1 << FIX_SIN_FRAC_BITS) - 1);
+    fix16_t val = fix_sin_tbl[idx];
+    if (frac != 0)
+        val += ((fix_sin_tbl[idx + 1] - val) * frac) >> FIX_SIN_FRAC_BITS;
+    // the second half of the turn is the first half, upside down
+    return (a & FIX_ANGLE_180) ? -val : val;
+}
+
+/*
+** Angle of a vector. On the screen, where y runs down, angles go clockwise
+** from the x axis
+**
+** @param y y component of the vector
+** @param x x component of the vector
+** @return Angle of the vector, within about a quarter of a degree. 0 when
+**         both components are 0
+*/
+fix_angle_t fix_atan2(int32_t y, int32_t x)
+{
+    uint32_t ux = (x < 0) ? -(uint32_t)x : (uint32_t)x;
+    uint32_t uy = (y < 0) ? -(uint32_t)y : (uint32_t)y;
+    if ((ux == 0) && (uy == 0))
+        return 0;
+    // work out the angle in the first octant, from the ratio of the shorter
+    // side to the longer one, then fold it out to the vector's octant
+    uint32_t t = (ux >= uy) ? fix_div(uy, ux) : fix_div(ux, uy);
+    uint16_t ang = ((t << 13)
+        + (FIX_ATAN_K * ((t * (FIX16_ONE - t)) >> FIX16_SHIFT))) >> 16;
+    if (uy > ux)
+        ang = FIX_ANGLE_90 - ang;
+    if (x < 0)
+        ang = FIX_ANGLE_180 - ang;
+    if (y < 0)
+        ang = -ang;
+    return ang;
+}
+
+/*
+** Integer square root
+**
+** @param n Number to take the root of
+** @return Square root, rounded down
+*/
+uint16_t fix_isqrt(uint32_t n)
+{
+    // work out one bit of the root at a time, from the top
+    uint32_t root = 0;
+    for (uint32_t bit=(1UL << 30); bit!=0; bit>>=2)
+    {
+        if (n >= (root + bit))
+        {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+    }
+    return root;
+}
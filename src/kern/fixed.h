@@ -0,0 +1,117 @@
+/*
+** File:    fixed.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Fixed point math library. There is no FPU to rely on (and no
+**              room for a soft float library), so fractions are kept in
+**              integers: 16.16 for general math and 8.8 where 16 bits have
+**              to do. Angles are binary; a full turn is 65536, so they wrap
+**              around on their own
+*/
+#ifndef _FIXED_H_
+#define _FIXED_H_
+
+/** Headers    **/
+#include "gcc16.h"
+#include "types.h"
+
+/** Macros     **/
+// 16.16 fixed point
+#define FIX16_SHIFT     16
+#define FIX16_ONE       ((fix16_t)1 << FIX16_SHIFT)
+#define FIX16(i)        ((fix16_t)(i) << FIX16_SHIFT)
+// integer part, rounded down or to the nearest
+#define FIX16_INT(f)    ((f) >> FIX16_SHIFT)
+#define FIX16_ROUND(f)  (((f) + (FIX16_ONE / 2)) >> FIX16_SHIFT)
+
+// 8.8 fixed point
+#define FIX8_SHIFT      8
+#define FIX8_ONE        ((fix8_t)1 << FIX8_SHIFT)
+#define FIX8(i)         ((fix8_t)((i) << FIX8_SHIFT))
+#define FIX8_INT(f)     ((f) >> FIX8_SHIFT)
+#define FIX8_ROUND(f)   (((f) + (FIX8_ONE / 2)) >> FIX8_SHIFT)
+// 8.8 products fit in 32 bits, so these are cheap enough to inline
+#define fix8_mul(a, b)  ((fix8_t)(((int32_t)(a) * (b)) >> FIX8_SHIFT))
+#define fix8_div(a, b)  ((fix8_t)(((int32_t)(a) << FIX8_SHIFT) / (b)))
+
+// binary angles
+#define FIX_ANGLE_TURN  0x10000UL
+#define FIX_ANGLE_90    0x4000
+#define FIX_ANGLE_180   0x8000
+// angle of step i out of n steps in a full turn (Ex: a minute on a clock)
+#define FIX_ANGLE_STEP(i, n) \
+    ((fix_angle_t)(((uint32_t)(i) * FIX_ANGLE_TURN) / (n)))
+// angle from degrees; meant for constants
+#define FIX_ANGLE_DEG(d) FIX_ANGLE_STEP(d, 360)
+
+/** Globals    **/
+
+/** Structures **/
+
+// 16.16 fixed point number
+typedef int32_t fix16_t;
+// 8.8 fixed point number
+typedef int16_t fix8_t;
+// binary angle, see FIX_ANGLE_TURN
+typedef uint16_t fix_angle_t;
+
+/** Functions  **/
+
+/*
+** Multiplies two 16.16 numbers
+**
+** @param a First factor
+** @param b Second factor
+** @return Product, rounded down
+*/
+fix16_t fix_mul(fix16_t a, fix16_t b);
+
+/*
+** Divides two 16.16 numbers
+**
+** @param a Dividend
+** @param b Divisor
+** @return Quotient, rounded towards 0. Quotients that don't fit (including
+**         anything divided by 0) are clamped to the largest value of the
+**         right sign
+*/
+fix16_t fix_div(fix16_t a, fix16_t b);
+
+/*
+** Sine of an angle. A quarter-wave table is read and interpolated between
+** entries
+**
+** @param a Angle
+** @return Sine, 16.16
+*/
+fix16_t fix_sin(fix_angle_t a);
+
+/*
+** Cosine of an angle
+**
+** @param a Angle
+** @return Cosine, 16.16
+*/
+#define fix_cos(a) fix_sin((fix_angle_t)((a) + FIX_ANGLE_90))
+
+/*
+** Angle of a vector. On the screen, where y runs down, angles go clockwise
+** from the x axis
+**
+** @param y y component of the vector
+** @param x x component of the vector
+** @return Angle of the vector, within about a quarter of a degree. 0 when
+**         both components are 0
+*/
+fix_angle_t fix_atan2(int32_t y, int32_t x);
+
+/*
+** Integer square root
+**
+** @param n Number to take the root of
+** @return Square root, rounded down
+*/
+uint16_t fix_isqrt(uint32_t n);
+
+#endif
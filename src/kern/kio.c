@@ -12,12 +12,15 @@
 #include "gcc16.h"
 #include "kio.h"
 
-// pointer to video memory; character to display
-static volatile char* txt_ptr = (volatile char*)TEXT_MEM_BEGIN;
+#include "mem_map.h"
 
 // alternative frame buffer for text output. This will allow us to write to
 // text memory even in graphics mode, analogous to a TTY session on Linux
-static volatile char txt_fb[TEXT_MEM_SIZE];
+#define TXT_FB  MEM_FAR(volatile char, MEM_TEXT_BACK)
+
+// pointer to video memory; character to display
+static volatile char* txt_ptr = (volatile char*)TEXT_MEM_BEGIN;
+
 // reference to the current start of text memory. This will depend on which
 // buffer we are writing to
 static volatile char* txt_mem_begin = (volatile char*)TEXT_MEM_BEGIN;
@@ -494,9 +497,9 @@ void kio_swap_fb()
 {
     // use 16-bit ptrs to cut memory access in half
     volatile uint16_t* cp_mem_ptr = (volatile uint16_t*)TEXT_MEM_BEGIN;
-    volatile uint16_t* cp_fb_ptr = (volatile uint16_t*)txt_fb;
+    volatile uint16_t* cp_fb_ptr = (volatile uint16_t*)TXT_FB;
     // frame buffer is currently active
-    if (txt_mem_begin == txt_fb)
+    if (txt_mem_begin == TXT_FB)
     {
         // update pointers to relative addresses in the video memory
         txt_ptr = (volatile char*)TEXT_MEM_BEGIN + (txt_ptr - txt_mem_begin);
@@ -516,8 +519,8 @@ void kio_swap_fb()
             cp_mem_ptr[i] = 0;
         }
         // update pointers to relative addresses in the frame buffer
-        txt_ptr = txt_fb + (txt_ptr - txt_mem_begin);
-        txt_mem_begin = txt_fb;
+        txt_ptr = TXT_FB + (txt_ptr - txt_mem_begin);
+        txt_mem_begin = TXT_FB;
     }
 }
 
@@ -0,0 +1,64 @@
+/*
+** File:    mem_map.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Fixed locations of large buffers in physical memory.
+**              gcc addresses globals with 16-bit offsets, so everything the
+**              linker places has to fit in the first 64kB (along with the
+**              stack). Anything big lives past that, at a fixed address, and
+**              is reached through a pointer, the same way video memory is.
+**              Those pointers have to come from MEM_FAR(), see below.
+*/
+#ifndef _MEM_MAP_H_
+#define _MEM_MAP_H_
+
+/** Headers    **/
+#include "gcc16.h"
+#include "types.h"
+
+/** Macros     **/
+// Pointer to one of the buffers below. gcc folds a constant address and a
+// constant index into one absolute operand, which gas cuts down to 16 bits
+// under .code16gcc. Passing the address through a register hides it from gcc,
+// so every access is made relative to a 32-bit register instead
+#define MEM_FAR(type, addr) \
+    ({ uint32_t __far = (addr); __asm__("" : "+r"(__far)); (type*)__far; })
+
+// the boot loader stages the OS image here before copying it into place;
+// free to use once the kernel is running
+#define MEM_STAGING_BEGIN   0x10000
+#define MEM_STAGING_END     0x20000
+
+// VGA13 inverse color map (4kB)
+#define MEM_VGA13_INV_MAP   0x20000
+// text mode font (8kB) and DAC colors (192 bytes), saved while in graphics
+#define MEM_TEXT_FONT       0x21000
+#define MEM_TEXT_DAC        0x23000
+// VGA13 palette entry recency stamps (1kB) and inverse color map cells that
+// are filled in, one bit each (512 bytes)
+#define MEM_VGA13_STAMP     0x23400
+#define MEM_VGA13_INV_VALID 0x23800
+// VGA13 shadow palette (768 bytes), hash chain links and pin counts (256 bytes
+// each)
+#define MEM_VGA13_PALETTE   0x23A00
+#define MEM_VGA13_NEXT      0x23D00
+#define MEM_VGA13_PIN       0x23E00
+// text written while in graphics mode, shown again on the way out (4000 bytes)
+#define MEM_TEXT_BACK       0x24000
+// SeeFont glyphs broken down into blocks, built as they are drawn (12255 bytes)
+#define MEM_GLYPH_SPANS     0x25000
+// rendered text kept by the pane library, see tcache.h (up to 32768 bytes)
+#define MEM_TEXT_CACHE      0x28000
+// copy of the Mode 13h screen, kept while the mode is left (64000 bytes)
+#define MEM_VGA13_SAVE      0x30000
+// Mode 13h back buffer, drawn to in place of video memory (64000 bytes)
+#define MEM_VGA13_BACK      0x40000
+// CGA quantized RGB -> nearest palette entry table (512 bytes)
+#define MEM_CGA_NEAR        0x50000
+// VGA13 scanline offsets (400 bytes)
+#define MEM_VGA13_ROW       0x50200
+// index of the text cache kept by the pane library (TCache, 404 bytes)
+#define MEM_PANE_TCACHE     0x50400
+
+#endif
@@ -18,6 +18,10 @@ typedef uint8_t         byte_t;
 typedef uint8_t         bool;
 typedef short           int16_t;
 typedef unsigned short  uint16_t;
+typedef long            int32_t;
+typedef unsigned long   uint32_t;
+typedef long long       int64_t;
+typedef unsigned long long uint64_t;
 
 // bit masks that for loading the lower/upper byte of a short (16 bits)
 #define LOAD_LO_BYTE_MASK 0xFF
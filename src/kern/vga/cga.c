@@ -0,0 +1,262 @@
+/*
+** File:    cga.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Driver for CGA's 320x200 4 color graphics modes (4 and 5)
+**              Pixels are packed 4 to a byte, and even and odd scanlines are
+**              stored in separate banks. Colors come from a fixed palette, so
+**              requested colors are mapped onto the closest one
+*/
+
+/** Headers    **/
+#include "../gcc16.h"
+#include "../mem_map.h"
+#include "cga.h"
+
+/** Macros     **/
+// quantized RGB -> closest palette entry, filled in when the mode starts.
+// Kept out of the first 64kB, which is short on room
+#define CGA_NEAR    MEM_FAR(uint8_t, MEM_CGA_NEAR)
+
+/** Globals    **/
+// the high intensity palettes; what the two modes show on an RGB monitor
+static const RGB_8 cga_palettes[2][CGA_PALETTE_SIZE] =
+{
+    {{  0,   0,   0}, { 85, 255, 255}, {255,  85, 255}, {255, 255, 255}},
+    {{  0,   0,   0}, { 85, 255, 255}, {255,  85,  85}, {255, 255, 255}},
+};
+// palette of the current mode
+static const RGB_8* cga_palette;
+
+/************************** Internal Functions **************************/
+
+/*
+** Maps a color to the closest palette entry
+**
+** @param color RGB color
+** @return Palette entry, repeated for all 4 pixels of a byte
+*/
+static uint8_t __cga_fetch_color(RGB_8 color)
+{
+    uint16_t cell = ((color.r >> (8 - CGA_NEAR_BITS)) << (2 * CGA_NEAR_BITS))
+        | ((color.g >> (8 - CGA_NEAR_BITS)) << CGA_NEAR_BITS)
+        | (color.b >> (8 - CGA_NEAR_BITS));
+    return CGA_NEAR[cell];
+}
+
+/*
+** Gets the address of the start of a scanline
+**
+** @param y Scanline
+** @return Address of the first byte of the scanline
+*/
+static uint8_t* __cga_row(uint16_t y)
+{
+    return (uint8_t*)(CGA_MEM_BEGIN + ((y & 1) * CGA_BANK_SIZE)
+        + ((y >> 1) * CGA_ROW_SIZE));
+}
+
+/*
+** Writes the masked pixels of a byte, keeping the rest
+**
+** @param addr Byte to write to
+** @param mask Bits of the pixels to set
+** @param packed Color code repeated for all 4 pixels
+*/
+static void __cga_mask_write(uint8_t* addr, uint8_t mask, uint8_t packed)
+{
+    *addr = (*addr & ~mask) | (packed & mask);
+}
+
+/************************** Draw Functions **************************/
+
+/*
+** Clears the video buffer
+*/
+static void __cga_clrscr(void)
+{
+    vga_fill_span((uint8_t*)CGA_MEM_BEGIN, CGA_MEM_SIZE, 0);
+}
+
+/*
+** Vertical sync control. Useful for slow electron-gun-based displays
+*/
+static void __cga_vsync(void)
+{
+    vga_wait_retrace();
+}
+
+/*
+** Pushes pending changes out to the display. The palette is fixed, so there is
+** nothing to do
+*/
+static void __cga_present(void)
+{
+}
+
+/*
+** Write a pixel out to the frame buffer. This represents a single pixel
+**
+** @param x coordinate on the screen
+** @param y coordinate on the screen
+** @param color_code Color code to write
+*/
+static void __cga_put_pixel(uint16_t x, uint16_t y, uint8_t color_code)
+{
+    if (!VGA_CLIP_POINT(x, y))
+        return;
+    // leftmost pixel is in the high bits
+    __cga_mask_write(__cga_row(y) + (x >> 2), 0xC0 >> (2 * (x & 3)),
+        color_code);
+}
+
+/*
+** Read a pixel out of the frame buffer. This represents a single pixel
+**
+** @param x coordinate on the screen
+** @param y coordinate on the screen
+** @param color Pixel color written to the pixel position; black when the
+**        pixel is off the screen
+*/
+static void __cga_get_pixel(uint16_t x, uint16_t y, RGB_8* color)
+{
+    if (!VGA_SCREEN_POINT(x, y))
+    {
+        *color = (RGB_8){0, 0, 0};
+        return;
+    }
+    uint8_t bits = *(__cga_row(y) + (x >> 2)) >> (6 - (2 * (x & 3)));
+    *color = cga_palette[bits & 0b11];
+}
+
+/*
+** Draws a simple rectangle. Each scanline is filled as a span: a masked head
+** byte, whole bytes (4 pixels each) and a masked tail byte
+**
+** @param urx Upper-right x coordinate on the screen
+** @param ury Upper-right y coordinate on the screen
+** @param llx Lower-left x coordinate on the screen
+** @param lly Lower-left y coordinate on the screen
+** @param color_code Color code to write
+*/
+static void __cga_draw_rect(uint16_t urx, uint16_t ury, uint16_t llx,
+    uint16_t lly, uint8_t color_code)
+{
+    if (!vga_clip_rect(&llx, &ury, &urx, &lly))
+        return;
+    // byte columns holding the first and last pixels
+    uint16_t col0 = llx >> 2;
+    uint16_t col1 = (urx - 1) >> 2;
+    uint8_t l_mask = 0xFF >> (2 * (llx & 3));
+    uint8_t r_mask = 0xFF << (2 * (3 - ((urx - 1) & 3)));
+    if (col0 == col1)
+        l_mask &= r_mask;
+    for(uint16_t y=ury; y<lly; y++)
+    {
+        uint8_t* row = __cga_row(y);
+        __cga_mask_write(row + col0, l_mask, color_code);
+        if (col0 == col1)
+            continue;
+        vga_fill_span(row + col0 + 1, col1 - col0 - 1, color_code);
+        __cga_mask_write(row + col1, r_mask, color_code);
+    }
+}
+
+/*
+** Draws a simple rectangle, using alternative parameter listings
+**
+** @param ulx Upper-left x coordinate on the screen
+** @param uly Upper-left y coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param color_code Color code to write
+*/
+static void __cga_draw_rect_wh(uint16_t ulx, uint16_t uly, uint16_t w,
+    uint16_t h, uint8_t color_code)
+{
+    __cga_draw_rect(ulx + w, uly, ulx, uly + h, color_code);
+}
+
+/*
+** Start one of CGA's 4 color modes
+**
+** @param driver Standard driver spec for a driver to setup
+** @param mode Mode to start (4 or 5)
+*/
+static void __cga_enter(VGA_Driver* driver, uint8_t mode)
+{
+    driver->screen_w = CGA_WIDTH;
+    driver->screen_h = CGA_HEIGHT;
+    driver->frame_buff = (uint16_t*)CGA_MEM_BEGIN;
+    driver->vga_mode = mode;
+    // set all the functions here
+    driver->vga_enter = (mode == VGA_MODE_CGA4) ? &_cga4_enter : &_cga5_enter;
+    driver->vga_exit = NULL;
+    driver->vga_clrscr = &__cga_clrscr;
+    driver->vga_vsync = &__cga_vsync;
+    driver->vga_present = &__cga_present;
+    driver->vga_fetch_color = &__cga_fetch_color;
+    // the palette is fixed; codes never change
+    driver->vga_pin_color = NULL;
+    driver->vga_alloc_ramp = NULL;
+    driver->vga_free_ramp = NULL;
+    driver->vga_put_pixel = &__cga_put_pixel;
+    driver->vga_get_pixel = &__cga_get_pixel;
+    driver->vga_draw_rect = &__cga_draw_rect;
+    driver->vga_draw_rect_wh = &__cga_draw_rect_wh;
+    // spans, blits and copies are built on the functions above
+    vga_generic_ops(driver);
+    driver->vga_back_buffer = NULL;
+
+    // BIOS interrupt appears to clear memory on reset
+    uint16_t ax = mode;
+    __asm__ __volatile__("int $0x10" : "+a"(ax));
+    // select the high intensity colors (black background)
+    ax = 0x0B00;
+    __asm__ __volatile__("int $0x10" : "+a"(ax) : "b"(0x0010));
+
+    // build the nearest color table from the center of each cell, stored as
+    // the color code packed 4 times over, ready for byte writes
+    cga_palette = cga_palettes[mode - VGA_MODE_CGA4];
+    for(uint16_t cell=0; cell<CGA_NEAR_SIZE; cell++)
+    {
+        RGB_8 center = {
+            ((cell >> (2 * CGA_NEAR_BITS)) << (8 - CGA_NEAR_BITS)) | 0x10,
+            (((cell >> CGA_NEAR_BITS) & 0b111) << (8 - CGA_NEAR_BITS)) | 0x10,
+            ((cell & 0b111) << (8 - CGA_NEAR_BITS)) | 0x10
+        };
+        uint32_t best_val = 0xFFFFFFFF;
+        for(uint8_t i=0; i<CGA_PALETTE_SIZE; i++)
+        {
+            uint32_t dist = vga_RGB_8_dist(center, cga_palette[i]);
+            if (dist < best_val)
+            {
+                best_val = dist;
+                CGA_NEAR[cell] = i * 0b01010101;
+            }
+        }
+    }
+}
+
+/************************** GL-Visible Functions **************************/
+
+/*
+** Start CGA's mode 4 (black, cyan, magenta and white)
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _cga4_enter(VGA_Driver* driver)
+{
+    __cga_enter(driver, VGA_MODE_CGA4);
+}
+
+/*
+** Start CGA's mode 5 (black, cyan, red and white)
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _cga5_enter(VGA_Driver* driver)
+{
+    __cga_enter(driver, VGA_MODE_CGA5);
+}
@@ -0,0 +1,52 @@
+/*
+** File:    cga.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Driver for CGA's 320x200 4 color graphics modes (4 and 5)
+**              Pixels are packed 4 to a byte, and even and odd scanlines are
+**              stored in separate banks. Colors come from a fixed palette, so
+**              requested colors are mapped onto the closest one
+*/
+#ifndef _CGA_H_
+#define _CGA_H_
+
+/** Headers    **/
+#include "../gcc16.h"
+#include "../types.h"
+// standard header for VGA drivers
+#include "vga.h"
+
+/** Macros     **/
+// Graphics mode screen dimensions (2 bits per pixel in memory)
+#define CGA_WIDTH           320
+#define CGA_HEIGHT          200
+#define CGA_ROW_SIZE        (CGA_WIDTH / 4)
+// even scanlines start at the beginning of memory, odd ones 8kB in
+#define CGA_MEM_BEGIN       0xB8000
+#define CGA_BANK_SIZE       0x2000
+#define CGA_MEM_SIZE        (2 * CGA_BANK_SIZE)
+
+// number of colors on screen at once
+#define CGA_PALETTE_SIZE    4
+// nearest color table: RGB is quantized to this many bits per channel
+#define CGA_NEAR_BITS       3
+#define CGA_NEAR_SIZE       (1 << (3 * CGA_NEAR_BITS))
+
+/** Functions  **/
+
+/*
+** Start CGA's mode 4 (black, cyan, magenta and white)
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _cga4_enter(VGA_Driver* driver);
+
+/*
+** Start CGA's mode 5 (black, cyan, red and white)
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _cga5_enter(VGA_Driver* driver);
+
+#endif
@@ -0,0 +1,292 @@
+/*
+** File:    vbe.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Driver for 256 color VESA BIOS Extensions (VBE) modes
+**              Modes are found and set through the VBE BIOS. Bochs and QEMU
+**              also expose their display interface (DISPI) registers, which
+**              makes switching memory banks a single port write instead of a
+**              BIOS call
+*/
+
+/** Headers    **/
+#include "../gcc16.h"
+#include "../asm_lib.h"
+#include "vbe.h"
+// VBE shares the 256 color palette manager with Mode 13h
+#include "vga13.h"
+
+/** Globals    **/
+// bytes per scanline; may be more than the screen width
+static uint16_t vbe_pitch;
+// linear frame buffer, NULL if video memory goes through the banked window
+static uint8_t* vbe_lfb;
+// bank currently mapped into the window
+static uint16_t vbe_bank;
+// banks are numbered in units of the window granularity; this converts 64kB
+// units into bank numbers
+static uint8_t vbe_gran_shift;
+// set if the Bochs/QEMU display interface is available
+static bool vbe_dispi;
+
+/************************** Internal Functions **************************/
+
+/*
+** Calls a VBE BIOS function
+**
+** @param func VBE function number
+** @param bx Value for %bx (mode to set, window)
+** @param cx Value for %cx (mode to query)
+** @param dx Value for %dx (bank)
+** @param buff Buffer for the BIOS to fill in, if any
+** @return VBE_OK on success
+*/
+static uint16_t __vbe_bios(uint16_t func, uint16_t bx, uint16_t cx,
+    uint16_t dx, void* buff)
+{
+    uint16_t ret;
+    __asm__ __volatile__("int $0x10"
+        : "=a"(ret)
+        : "a"(func), "b"(bx), "c"(cx), "d"(dx), "D"(buff)
+        : "memory"
+    );
+    return ret;
+}
+
+/*
+** Gets the address of an offset into video memory, mapping in the right bank
+** if the frame buffer isn't linear
+**
+** @param offset Byte offset into video memory
+** @return Address to access the offset through
+*/
+static uint8_t* __vbe_addr(uint32_t offset)
+{
+    if (vbe_lfb)
+        return vbe_lfb + offset;
+    uint16_t bank = (offset >> 16) << vbe_gran_shift;
+    if (bank != vbe_bank)
+    {
+        vbe_bank = bank;
+        if (vbe_dispi)
+        {
+            _outw(VBE_DISPI_IDX_PORT, VBE_DISPI_REG_BANK);
+            _outw(VBE_DISPI_DATA_PORT, bank);
+        }
+        else
+            __vbe_bios(VBE_FUNC_SET_BANK, 0, 0, bank, NULL);
+    }
+    return (uint8_t*)(VBE_WINDOW_BEGIN + (offset & (VBE_WINDOW_SIZE - 1)));
+}
+
+/*
+** Fills a run of pixels in video memory, splitting it up wherever it crosses
+** into another bank
+**
+** @param offset Byte offset of the first pixel
+** @param n Number of pixels to fill
+** @param color_code Palette index to fill with
+*/
+static void __vbe_span(uint32_t offset, uint32_t n, uint8_t color_code)
+{
+    while (n > 0)
+    {
+        uint8_t* addr = __vbe_addr(offset);
+        uint32_t run = n;
+        uint32_t room = VBE_WINDOW_SIZE - (offset & (VBE_WINDOW_SIZE - 1));
+        if (!vbe_lfb && (run > room))
+            run = room;
+        vga_fill_span(addr, run, color_code);
+        offset += run;
+        n -= run;
+    }
+}
+
+/*
+** Searches the VBE BIOS mode list for a packed-pixel mode
+**
+** @param w Screen width
+** @param h Screen height
+** @param info Buffer to store the mode information into
+** @return Mode number, VBE_MODE_END if none is found
+*/
+static uint16_t __vbe_find_mode(uint16_t w, uint16_t h, VBE_Mode_Info* info)
+{
+    VBE_Info vbe_info;
+    // ask for the VBE 2.0+ version of the structure
+    vbe_info.sig[0] = 'V'; vbe_info.sig[1] = 'B';
+    vbe_info.sig[2] = 'E'; vbe_info.sig[3] = '2';
+    if (__vbe_bios(VBE_FUNC_INFO, 0, 0, 0, &vbe_info) != VBE_OK)
+        return VBE_MODE_END;
+    uint16_t* modes = (uint16_t*)(((uint32_t)vbe_info.modes_seg << 4)
+        + vbe_info.modes_off);
+    for(; *modes != VBE_MODE_END; ++modes)
+    {
+        if (__vbe_bios(VBE_FUNC_MODE_INFO, 0, *modes, 0, info) != VBE_OK)
+            continue;
+        if (((info->attr & VBE_ATTR_REQ) == VBE_ATTR_REQ)
+            && (info->w == w) && (info->h == h) && (info->bpp == VBE_BPP)
+            && (info->model == VBE_MODEL_PACKED))
+            return *modes;
+    }
+    return VBE_MODE_END;
+}
+
+/************************** Draw Functions **************************/
+
+/*
+** Clears the video buffer
+*/
+static void __vbe_clrscr(void)
+{
+    // nothing drawn before this point is visible anymore
+    _vga13_palette_epoch();
+    __vbe_span(0, (uint32_t)vbe_pitch * VBE_HEIGHT, 0);
+}
+
+/*
+** Leave the VBE mode. The registers that the other modes program don't cover
+** the extended ones (Bochs and QEMU keep their display interface turned on),
+** so the BIOS sets a standard VGA mode first
+*/
+static void __vbe_exit(void)
+{
+    __vbe_bios(VBE_FUNC_SET_MODE, VBE_MODE_VGA_TEXT | VBE_MODE_NO_CLEAR, 0, 0,
+        NULL);
+}
+
+/*
+** Write a pixel out to the frame buffer. This represents a single pixel
+**
+** @param x coordinate on the screen
+** @param y coordinate on the screen
+** @param color_code Color code to write
+*/
+static void __vbe_put_pixel(uint16_t x, uint16_t y, uint8_t color_code)
+{
+    if (!VGA_CLIP_POINT(x, y))
+        return;
+    *__vbe_addr(((uint32_t)y * vbe_pitch) + x) = color_code;
+}
+
+/*
+** Read a pixel out of the frame buffer. This represents a single pixel
+**
+** @param x coordinate on the screen
+** @param y coordinate on the screen
+** @param color Pixel color written to the pixel position; black when the
+**        pixel is off the screen
+*/
+static void __vbe_get_pixel(uint16_t x, uint16_t y, RGB_8* color)
+{
+    if (!VGA_SCREEN_POINT(x, y))
+    {
+        *color = (RGB_8){0, 0, 0};
+        return;
+    }
+    uint8_t color_code = *__vbe_addr(((uint32_t)y * vbe_pitch) + x);
+    *color = _vga13_palette_color(color_code);
+}
+
+/*
+** Draws a simple rectangle
+**
+** @param urx Upper-right x coordinate on the screen
+** @param ury Upper-right y coordinate on the screen
+** @param llx Lower-left x coordinate on the screen
+** @param lly Lower-left y coordinate on the screen
+** @param color_code Color code to write
+*/
+static void __vbe_draw_rect(uint16_t urx, uint16_t ury, uint16_t llx,
+    uint16_t lly, uint8_t color_code)
+{
+    if (!vga_clip_rect(&llx, &ury, &urx, &lly))
+        return;
+    uint32_t offset = ((uint32_t)ury * vbe_pitch) + llx;
+    for(uint16_t y=ury; y<lly; y++)
+    {
+        __vbe_span(offset, urx - llx, color_code);
+        offset += vbe_pitch;
+    }
+}
+
+/*
+** Draws a simple rectangle, using alternative parameter listings
+**
+** @param ulx Upper-left x coordinate on the screen
+** @param uly Upper-left y coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param color_code Color code to write
+*/
+static void __vbe_draw_rect_wh(uint16_t ulx, uint16_t uly, uint16_t w,
+    uint16_t h, uint8_t color_code)
+{
+    __vbe_draw_rect(ulx + w, uly, ulx, uly + h, color_code);
+}
+
+/************************** GL-Visible Functions **************************/
+
+/*
+** Start a VBE mode. Falls back to Mode 13h if no suitable mode is found
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _vbe_enter(VGA_Driver* driver)
+{
+    VBE_Mode_Info info;
+    uint16_t mode = __vbe_find_mode(VBE_WIDTH, VBE_HEIGHT, &info);
+    if (mode == VBE_MODE_END)
+    {
+        _vga13_enter(driver);
+        return;
+    }
+    vbe_pitch = info.pitch;
+    vbe_lfb = NULL;
+#ifdef VBE_LFB_REACHABLE
+    if ((info.attr & VBE_ATTR_LFB) && info.lfb)
+    {
+        vbe_lfb = (uint8_t*)info.lfb;
+        mode |= VBE_MODE_LFB;
+    }
+#endif
+    // window granularity is given in kB
+    vbe_gran_shift = 0;
+    while ((info.win_gran > 0) && ((64 >> vbe_gran_shift) > info.win_gran))
+        ++vbe_gran_shift;
+    // DISPI banks are always 64kB
+    _outw(VBE_DISPI_IDX_PORT, VBE_DISPI_REG_ID);
+    vbe_dispi =
+        (_inw(VBE_DISPI_DATA_PORT) & VBE_DISPI_ID_MASK) == VBE_DISPI_ID;
+    if (vbe_dispi)
+        vbe_gran_shift = 0;
+
+    driver->screen_w = VBE_WIDTH;
+    driver->screen_h = VBE_HEIGHT;
+    driver->frame_buff = (uint16_t*)(vbe_lfb ? vbe_lfb
+        : (uint8_t*)VBE_WINDOW_BEGIN);
+    driver->vga_mode = VGA_MODE_VBE;
+    // set all the functions here
+    driver->vga_enter = &_vbe_enter;
+    driver->vga_exit = &__vbe_exit;
+    driver->vga_clrscr = &__vbe_clrscr;
+    driver->vga_vsync = &_vga13_vsync;
+    driver->vga_present = &_vga13_flush_palette;
+    driver->vga_fetch_color = &_vga13_fetch_color;
+    driver->vga_pin_color = &_vga13_pin_color;
+    driver->vga_alloc_ramp = &_vga13_alloc_ramp;
+    driver->vga_free_ramp = &_vga13_free_ramp;
+    driver->vga_put_pixel = &__vbe_put_pixel;
+    driver->vga_get_pixel = &__vbe_get_pixel;
+    driver->vga_draw_rect = &__vbe_draw_rect;
+    driver->vga_draw_rect_wh = &__vbe_draw_rect_wh;
+    // spans, blits and copies are built on the functions above
+    vga_generic_ops(driver);
+    driver->vga_back_buffer = NULL;
+
+    // the BIOS clears video memory on a mode set; the window starts at bank 0
+    __vbe_bios(VBE_FUNC_SET_MODE, mode, 0, 0, NULL);
+    vbe_bank = 0;
+    _vga13_init_color();
+}
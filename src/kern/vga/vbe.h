@@ -0,0 +1,123 @@
+/*
+** File:    vbe.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Driver for 256 color VESA BIOS Extensions (VBE) modes
+**              Modes are found and set through the VBE BIOS. Bochs and QEMU
+**              also expose their display interface (DISPI) registers, which
+**              makes switching memory banks a single port write instead of a
+**              BIOS call
+*/
+#ifndef _VBE_H_
+#define _VBE_H_
+
+/** Headers    **/
+#include "../gcc16.h"
+#include "../types.h"
+// standard header for VGA drivers
+#include "vga.h"
+
+/** Macros     **/
+// Graphics mode screen dimensions (1 byte per pixel in memory)
+#define VBE_WIDTH           640
+#define VBE_HEIGHT          480
+#define VBE_BPP             8
+
+// The linear frame buffer sits far past 1MB. In real mode it can only be
+// reached when the CPU doesn't enforce the 64kB segment limit (like QEMU and
+// Bochs) or from unreal mode. Comment this out to always use the banked window
+#define VBE_LFB_REACHABLE
+
+// Banked access maps 64kB of video memory at a time into this window
+#define VBE_WINDOW_BEGIN    0xA0000
+#define VBE_WINDOW_SIZE     0x10000
+
+// VBE BIOS functions (INT 10h, %ax)
+#define VBE_FUNC_INFO       0x4F00
+#define VBE_FUNC_MODE_INFO  0x4F01
+#define VBE_FUNC_SET_MODE   0x4F02
+#define VBE_FUNC_SET_BANK   0x4F05
+// returned in %ax on success
+#define VBE_OK              0x004F
+// mode list terminator
+#define VBE_MODE_END        0xFFFF
+// set mode flag to map the linear frame buffer
+#define VBE_MODE_LFB        0x4000
+// set mode flag to leave video memory alone
+#define VBE_MODE_NO_CLEAR   0x8000
+// standard VGA text mode; setting it takes the card out of its VBE mode
+#define VBE_MODE_VGA_TEXT   0x0003
+// mode attributes: supported, graphics, and linear frame buffer available
+#define VBE_ATTR_REQ        0x0011
+#define VBE_ATTR_LFB        0x0080
+// "packed pixel" memory model; one byte per pixel
+#define VBE_MODEL_PACKED    4
+
+// Bochs/QEMU display interface registers
+#define VBE_DISPI_IDX_PORT  0x01CE
+#define VBE_DISPI_DATA_PORT 0x01CF
+#define VBE_DISPI_REG_ID    0x00
+#define VBE_DISPI_REG_BANK  0x05
+// IDs are 0xB0C0 through 0xB0C5, depending on the version
+#define VBE_DISPI_ID_MASK   0xFFF0
+#define VBE_DISPI_ID        0xB0C0
+
+/** Structures **/
+
+// VBE controller information, filled in by the BIOS
+typedef struct VBE_Info
+{
+    char     sig[4];
+    uint16_t version;
+    uint16_t oem_off;
+    uint16_t oem_seg;
+    uint16_t caps[2];
+    // real mode far pointer to the list of mode numbers
+    uint16_t modes_off;
+    uint16_t modes_seg;
+    uint16_t mem_blocks;
+    uint8_t  reserved[492];
+} VBE_Info;
+
+// VBE mode information, filled in by the BIOS
+typedef struct VBE_Mode_Info
+{
+    uint16_t attr;
+    uint8_t  win_a_attr;
+    uint8_t  win_b_attr;
+    // window granularity, in kB
+    uint16_t win_gran;
+    uint16_t win_size;
+    uint16_t win_a_seg;
+    uint16_t win_b_seg;
+    uint32_t win_func;
+    // bytes per scanline
+    uint16_t pitch;
+    uint16_t w;
+    uint16_t h;
+    uint8_t  char_w;
+    uint8_t  char_h;
+    uint8_t  planes;
+    uint8_t  bpp;
+    uint8_t  banks;
+    uint8_t  model;
+    uint8_t  bank_size;
+    uint8_t  pages;
+    uint8_t  reserved0;
+    uint8_t  masks[9];
+    // physical address of the linear frame buffer
+    uint32_t lfb;
+    uint8_t  reserved1[212];
+} VBE_Mode_Info;
+
+/** Functions  **/
+
+/*
+** Start a VBE mode. Falls back to Mode 13h if no suitable mode is found
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _vbe_enter(VGA_Driver* driver);
+
+#endif
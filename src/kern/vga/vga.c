@@ -8,9 +8,37 @@
 
 /** Headers    **/
 #include "../gcc16.h"
+#include "../asm_lib.h"
+#include "../mem_map.h"
 #include "vga.h"
 
 /** Globals    **/
+// 80x25 text mode registers
+static const uint8_t vga_text_regs[VGA_REGS_SIZE] =
+{
+    // misc
+    0x67,
+    // sequencer
+    0x03, 0x00, 0x03, 0x00, 0x02,
+    // CRTC (0x0A: cursor start, with the cursor turned off)
+    0x5F, 0x4F, 0x50, 0x82, 0x55, 0x81, 0xBF, 0x1F,
+    0x00, 0x4F, 0x20, 0x0E, 0x00, 0x00, 0x00, 0x50,
+    0x9C, 0x0E, 0x8F, 0x28, 0x1F, 0x96, 0xB9, 0xA3, 0xFF,
+    // graphics controller
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x0E, 0x00, 0xFF,
+    // attribute controller
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x14, 0x07,
+    0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+    0x0C, 0x00, 0x0F, 0x08, 0x00,
+};
+// set once the text font and colors have been saved
+static bool vga_text_saved;
+// driver that the generic span, blit and copy operations draw through
+static VGA_Driver* vga_gen_driver;
+// area that drivers are allowed to draw in
+VGA_Rect vga_clip;
+// the whole screen of the current mode
+VGA_Rect vga_screen;
 
 /** Functions  **/
 
@@ -25,3 +53,546 @@ bool vga_RGB_8_cmp(RGB_8 c0, RGB_8 c1)
 {
     return (c0.r == c1.r) && (c0.g == c1.g) && (c0.b == c1.b);
 }
+
+/*
+** Perceptually weighted distance between two colors (the eye is most
+** sensitive to green, then red, then blue)
+**
+** @param c0 First color
+** @param c1 Second color
+** @return Squared, weighted distance
+*/
+uint32_t vga_RGB_8_dist(RGB_8 c0, RGB_8 c1)
+{
+    int32_t dr = c0.r - c1.r;
+    int32_t dg = c0.g - c1.g;
+    int32_t db = c0.b - c1.b;
+    return (3 * dr * dr) + (4 * dg * dg) + (2 * db * db);
+}
+
+/*
+** Picks a color on the line between two colors
+**
+** @param c0 First color
+** @param c1 Last color
+** @param k Step to pick; 0 is c0 and n - 1 is c1
+** @param n Number of evenly spaced steps from c0 to c1
+** @return Color of step k
+*/
+RGB_8 vga_RGB_8_step(RGB_8 c0, RGB_8 c1, uint8_t k, uint8_t n)
+{
+    if (n > 1)
+    {
+        c0.r += (((int16_t)c1.r - c0.r) * k) / (n - 1);
+        c0.g += (((int16_t)c1.g - c0.g) * k) / (n - 1);
+        c0.b += (((int16_t)c1.b - c0.b) * k) / (n - 1);
+    }
+    return c0;
+}
+
+/*
+** Waits for the start of the next vertical retrace
+*/
+void vga_wait_retrace(void)
+{
+    // bit 3 indicates whether or not the display has finished tracing pixels
+    // wait for a previous retrace to end
+    while (_inb(VGA_STATUS_PORT) & 0b1000) {};
+    // wait for a new retrace to begin
+    while (!(_inb(VGA_STATUS_PORT) & 0b1000)) {};
+}
+
+/*
+** Writes to an indexed VGA register (sequencer, graphics controller, CRTC)
+**
+** @param port Index port of the register group
+** @param idx Register index
+** @param val Value to write
+*/
+void vga_write_reg(uint16_t port, uint8_t idx, uint8_t val)
+{
+    _outb(port, idx);
+    // data port always follows the index port
+    _outb(port + 1, val);
+}
+
+/*
+** Reads from an indexed VGA register (sequencer, graphics controller, CRTC)
+**
+** @param port Index port of the register group
+** @param idx Register index
+** @return Register value
+*/
+uint8_t vga_read_reg(uint16_t port, uint8_t idx)
+{
+    _outb(port, idx);
+    return _inb(port + 1);
+}
+
+/*
+** Fills a run of 8-bit pixels in video memory. Bulk of the run is written with
+** 32-bit stores
+**
+** @param addr Address of the first pixel
+** @param n Number of pixels to fill
+** @param color_code Palette index to fill with
+*/
+void vga_fill_span(uint8_t* addr, uint32_t n, uint8_t color_code)
+{
+    // line up for the wide stores
+    for(; ((uint32_t)addr & 3) && n; n--)
+    {
+        *addr++ = color_code;
+    }
+    uint32_t packed_color = color_code * 0x01010101;
+    for(; n>=sizeof(uint32_t); n-=sizeof(uint32_t))
+    {
+        *((uint32_t*)addr) = packed_color;
+        addr += sizeof(uint32_t);
+    }
+    for(; n; n--)
+    {
+        *addr++ = color_code;
+    }
+}
+
+/*
+** Copies a run of 8-bit pixels. Bulk of the run is copied with 32-bit moves
+** when both sides line up the same way
+**
+** @param dst Address of the first pixel to write
+** @param src Address of the first pixel to read
+** @param n Number of pixels to copy
+*/
+void vga_copy_span(uint8_t* dst, const uint8_t* src, uint32_t n)
+{
+    if ((((uint32_t)dst ^ (uint32_t)src) & 3) == 0)
+    {
+        // line up for the wide moves
+        for(; ((uint32_t)dst & 3) && n; n--)
+        {
+            *dst++ = *src++;
+        }
+        for(; n>=sizeof(uint32_t); n-=sizeof(uint32_t))
+        {
+            *((uint32_t*)dst) = *((const uint32_t*)src);
+            dst += sizeof(uint32_t);
+            src += sizeof(uint32_t);
+        }
+    }
+    for(; n; n--)
+    {
+        *dst++ = *src++;
+    }
+}
+
+/*
+** Clips a rectangle to another. The upper-left corner may be left of or above
+** the screen, as a negative number. Callers work out x1 and y1 as x0 plus the
+** width (or height) in 16 bits, which wraps around for such a corner, so the
+** clipping is done on the width and height in 32 bits
+**
+** @param clip Rectangle to clip to
+** @param x0 Left-most x coordinate (inclusive), updated in place
+** @param y0 Top-most y coordinate (inclusive), updated in place
+** @param x1 Right-most x coordinate (exclusive), updated in place
+** @param y1 Bottom-most y coordinate (exclusive), updated in place
+** @return False if nothing is left
+*/
+static bool __vga_clip_to(const VGA_Rect* clip, uint16_t* x0, uint16_t* y0,
+    uint16_t* x1, uint16_t* y1)
+{
+    int32_t l = (int16_t)*x0;
+    int32_t t = (int16_t)*y0;
+    int32_t r = l + (uint16_t)(*x1 - *x0);
+    int32_t b = t + (uint16_t)(*y1 - *y0);
+    if (l < clip->x0)
+        l = clip->x0;
+    if (t < clip->y0)
+        t = clip->y0;
+    if (r > clip->x1)
+        r = clip->x1;
+    if (b > clip->y1)
+        b = clip->y1;
+    if ((l >= r) || (t >= b))
+        return false;
+    *x0 = l;
+    *y0 = t;
+    *x1 = r;
+    *y1 = b;
+    return true;
+}
+
+/*
+** Clips a rectangle to the clip rectangle. The upper-left corner may be left
+** of or above the screen
+**
+** @param x0 Left-most x coordinate (inclusive), updated in place
+** @param y0 Top-most y coordinate (inclusive), updated in place
+** @param x1 Right-most x coordinate (exclusive), updated in place
+** @param y1 Bottom-most y coordinate (exclusive), updated in place
+** @return False if nothing is left to draw
+*/
+bool vga_clip_rect(uint16_t* x0, uint16_t* y0, uint16_t* x1, uint16_t* y1)
+{
+    return __vga_clip_to(&vga_clip, x0, y0, x1, y1);
+}
+
+/*
+** Clips the destination of a screen-to-screen copy to the clip rectangle and
+** the source to the screen, moving the other side along with each
+**
+** @param sx Upper-left x coordinate to copy from, updated in place
+** @param sy Upper-left y coordinate to copy from, updated in place
+** @param dx Upper-left x coordinate to copy to, updated in place
+** @param dy Upper-left y coordinate to copy to, updated in place
+** @param w Width of the area, updated in place
+** @param h Height of the area, updated in place
+** @return False if nothing is left to copy
+*/
+bool vga_clip_copy(uint16_t* sx, uint16_t* sy, uint16_t* dx, uint16_t* dy,
+    uint16_t* w, uint16_t* h)
+{
+    uint16_t x0 = *sx, y0 = *sy, x1 = *sx + *w, y1 = *sy + *h;
+    if (!__vga_clip_to(&vga_screen, &x0, &y0, &x1, &y1))
+        return false;
+    *dx += x0 - *sx;
+    *dy += y0 - *sy;
+    *sx = x0;
+    *sy = y0;
+    *w = x1 - x0;
+    *h = y1 - y0;
+    x0 = *dx, y0 = *dy, x1 = *dx + *w, y1 = *dy + *h;
+    if (!vga_clip_rect(&x0, &y0, &x1, &y1))
+        return false;
+    *sx += x0 - *dx;
+    *sy += y0 - *dy;
+    *dx = x0;
+    *dy = y0;
+    *w = x1 - x0;
+    *h = y1 - y0;
+    return true;
+}
+
+/*
+** Calculates the area of the smallest rectangle holding two others
+**
+** @param r0 First rectangle
+** @param r1 Second rectangle, replaced by the bounding rectangle
+** @return Area of the bounding rectangle
+*/
+static uint32_t __vga_rect_union(const VGA_Rect* r0, VGA_Rect* r1)
+{
+    if (r0->x0 < r1->x0)
+        r1->x0 = r0->x0;
+    if (r0->y0 < r1->y0)
+        r1->y0 = r0->y0;
+    if (r0->x1 > r1->x1)
+        r1->x1 = r0->x1;
+    if (r0->y1 > r1->y1)
+        r1->y1 = r0->y1;
+    return (uint32_t)(r1->x1 - r1->x0) * (r1->y1 - r1->y0);
+}
+
+/*
+** Adds an area to a dirty list. Areas that overlap or touch ones already in
+** the list are merged with them. Once the list is full, the new area is merged
+** with whichever area it grows the least
+**
+** @param dirty Dirty list
+** @param x0 Left-most x coordinate (inclusive)
+** @param y0 Top-most y coordinate (inclusive)
+** @param x1 Right-most x coordinate (exclusive)
+** @param y1 Bottom-most y coordinate (exclusive)
+*/
+void vga_dirty_add(VGA_Dirty* dirty, uint16_t x0, uint16_t y0, uint16_t x1,
+    uint16_t y1)
+{
+    VGA_Rect add = {x0, y0, x1, y1};
+    uint8_t i = 0;
+    while (i < dirty->cnt)
+    {
+        VGA_Rect* r = &dirty->rect[i];
+        // already covered; the common case for runs of small draws
+        if ((add.x0 >= r->x0) && (add.y0 >= r->y0) && (add.x1 <= r->x1)
+            && (add.y1 <= r->y1))
+        {
+            return;
+        }
+        if ((add.x0 <= r->x1) && (r->x0 <= add.x1) && (add.y0 <= r->y1)
+            && (r->y0 <= add.y1))
+        {
+            // absorb the area and start over; it may touch others now
+            __vga_rect_union(r, &add);
+            *r = dirty->rect[--dirty->cnt];
+            i = 0;
+        }
+        else
+            ++i;
+    }
+    if (dirty->cnt == VGA_DIRTY_MAX)
+    {
+        // no room; merge with the area that grows the least
+        uint8_t best = 0;
+        uint32_t best_grow = 0xFFFFFFFF;
+        for (i=0; i<dirty->cnt; ++i)
+        {
+            VGA_Rect* r = &dirty->rect[i];
+            VGA_Rect u = *r;
+            uint32_t grow = __vga_rect_union(&add, &u)
+                - ((uint32_t)(r->x1 - r->x0) * (r->y1 - r->y0));
+            if (grow < best_grow)
+            {
+                best = i;
+                best_grow = grow;
+            }
+        }
+        __vga_rect_union(&add, &dirty->rect[best]);
+        return;
+    }
+    dirty->rect[dirty->cnt++] = add;
+}
+
+/*
+** Draws a horizontal run of pixels as a 1 pixel high rectangle
+**
+** @param x Left-most x coordinate on the screen
+** @param y coordinate on the screen
+** @param w Number of pixels to draw
+** @param color_code Color code to write
+*/
+static void __vga_gen_hspan(uint16_t x, uint16_t y, uint16_t w,
+    uint8_t color_code)
+{
+    vga_gen_driver->vga_draw_rect_wh(x, y, w, 1, color_code);
+}
+
+/*
+** Draws a vertical run of pixels as a 1 pixel wide rectangle
+**
+** @param x coordinate on the screen
+** @param y Top-most y coordinate on the screen
+** @param h Number of pixels to draw
+** @param color_code Color code to write
+*/
+static void __vga_gen_vspan(uint16_t x, uint16_t y, uint16_t h,
+    uint8_t color_code)
+{
+    vga_gen_driver->vga_draw_rect_wh(x, y, 1, h, color_code);
+}
+
+/*
+** Draws a row of palette indices, one horizontal span per run of equal
+** indices
+**
+** @param x Left-most x coordinate on the screen
+** @param y coordinate on the screen
+** @param w Number of pixels in the row
+** @param idx Palette index of each pixel
+** @param pal Palette the indices refer to, as color codes
+** @param key Index that is left transparent, VGA_BLIT_OPAQUE for none
+*/
+static void __vga_gen_blit_row(uint16_t x, uint16_t y, uint16_t w,
+    const uint8_t* idx, const uint8_t* pal, uint16_t key)
+{
+    uint16_t x0 = x, y0 = y, x1 = x + w, y1 = y + 1;
+    if (!vga_clip_rect(&x0, &y0, &x1, &y1))
+        return;
+    w = x1 - x;
+    uint16_t i = x0 - x;
+    while (i < w)
+    {
+        uint16_t run = i;
+        uint8_t code = idx[i];
+        while ((i < w) && (idx[i] == code))
+            ++i;
+        if (code != key)
+            vga_gen_driver->vga_hspan(x + run, y, i - run, pal[code]);
+    }
+}
+
+/*
+** Draws a 1 bit-per-pixel mask, one horizontal span per run of set bits.
+** The background, if any, is filled in first as one rectangle
+**
+** @param x Left-most x coordinate on the screen
+** @param y Top-most y coordinate on the screen
+** @param w Width of the mask, in pixels
+** @param h Height of the mask, in pixels
+** @param bits Mask rows
+** @param stride Number of bytes between the start of each mask row
+** @param color_code Color code to write for set bits
+** @param bg_code Color code to write for clear bits, VGA_BLIT_CLEAR to
+**        leave them alone
+*/
+static void __vga_gen_blit_mask(uint16_t x, uint16_t y, uint16_t w,
+    uint16_t h, const uint8_t* bits, uint16_t stride, uint8_t color_code,
+    uint16_t bg_code)
+{
+    uint16_t x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+    if (!vga_clip_rect(&x0, &y0, &x1, &y1))
+        return;
+    if (bg_code != VGA_BLIT_CLEAR)
+        vga_gen_driver->vga_draw_rect_wh(x0, y0, x1 - x0, y1 - y0, bg_code);
+    // only walk the part of the mask that is visible
+    w = x1 - x;
+    bits += (y0 - y) * stride;
+    for (uint16_t row=y0 - y; row<(y1 - y); ++row, bits+=stride)
+    {
+        uint16_t col = x0 - x;
+        while (col < w)
+        {
+            if (!(bits[col >> 3] & (0x80 >> (col & 7))))
+            {
+                ++col;
+                continue;
+            }
+            uint16_t run = col;
+            while ((col < w) && (bits[col >> 3] & (0x80 >> (col & 7))))
+                ++col;
+            vga_gen_driver->vga_hspan(x + run, y + row, col - run,
+                color_code);
+        }
+    }
+}
+
+/*
+** Copies one area of the screen to another, a pixel at a time. When the
+** destination comes after the source, the copy runs backwards so that
+** overlapping pixels are read before they are written over
+**
+** @param sx Upper-left x coordinate to copy from
+** @param sy Upper-left y coordinate to copy from
+** @param dx Upper-left x coordinate to copy to
+** @param dy Upper-left y coordinate to copy to
+** @param w Width of the area
+** @param h Height of the area
+*/
+static void __vga_gen_copy_rect(uint16_t sx, uint16_t sy, uint16_t dx,
+    uint16_t dy, uint16_t w, uint16_t h)
+{
+    if (!vga_clip_copy(&sx, &sy, &dx, &dy, &w, &h))
+        return;
+    bool back = (dy > sy) || ((dy == sy) && (dx > sx));
+    for (uint16_t j=0; j<h; ++j)
+    {
+        uint16_t row = back ? (h - 1 - j) : j;
+        for (uint16_t i=0; i<w; ++i)
+        {
+            uint16_t col = back ? (w - 1 - i) : i;
+            RGB_8 color;
+            vga_gen_driver->vga_get_pixel(sx + col, sy + row, &color);
+            vga_gen_driver->vga_put_pixel(dx + col, dy + row,
+                vga_gen_driver->vga_fetch_color(color));
+        }
+    }
+}
+
+/*
+** Fills in the span, blit and copy operations of a driver with generic
+** versions built on top of the driver's own pixel and rectangle functions.
+** Drivers without faster versions of their own call this when entering
+**
+** @param driver Driver, with the pixel and rectangle functions already set
+*/
+void vga_generic_ops(VGA_Driver* driver)
+{
+    vga_gen_driver = driver;
+    driver->vga_hspan = &__vga_gen_hspan;
+    driver->vga_vspan = &__vga_gen_vspan;
+    driver->vga_blit_row = &__vga_gen_blit_row;
+    driver->vga_blit_mask = &__vga_gen_blit_mask;
+    driver->vga_copy_rect = &__vga_gen_copy_rect;
+}
+
+/*
+** Programs a full set of VGA registers, switching modes without the BIOS.
+** Video memory is left as is
+**
+** @param regs Register table (VGA_REGS_SIZE bytes)
+*/
+void vga_write_regs(const uint8_t* regs)
+{
+    _outb(VGA_MISC_OUT_PORT, *regs++);
+    for(uint8_t i=0; i<VGA_REGS_SEQ; i++)
+        vga_write_reg(VGA_SEQ_IDX_PORT, i, *regs++);
+    // CRTC registers 0-7 are write protected by a bit in register 0x11
+    vga_write_reg(VGA_CRTC_IDX_PORT, 0x11, 0x00);
+    for(uint8_t i=0; i<VGA_REGS_CRTC; i++)
+        vga_write_reg(VGA_CRTC_IDX_PORT, i, *regs++);
+    for(uint8_t i=0; i<VGA_REGS_GC; i++)
+        vga_write_reg(VGA_GC_IDX_PORT, i, *regs++);
+    for(uint8_t i=0; i<VGA_REGS_AC; i++)
+    {
+        _inb(VGA_STATUS_PORT);
+        _outb(VGA_AC_PORT, i);
+        _outb(VGA_AC_PORT, *regs++);
+    }
+    _inb(VGA_STATUS_PORT);
+    _outb(VGA_AC_PORT, VGA_AC_ENABLE);
+}
+
+/*
+** Copies the text mode font to or from plane 2, where the VGA keeps it. Must be
+** called in text mode
+**
+** @param save True to copy the font out of video memory, false to restore it
+*/
+static void __vga_font_copy(bool save)
+{
+    // map plane 2 on its own at 0xA0000, addressed sequentially
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MAP_MASK, 0x04);
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MEM_MODE, 0x06);
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_READ_MAP, 0x02);
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_MODE, 0x00);
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_MISC, 0x04);
+    uint32_t* vram = (uint32_t*)0xA0000;
+    uint32_t* font = MEM_FAR(uint32_t, MEM_TEXT_FONT);
+    for(uint16_t i=0; i<(VGA_FONT_SIZE / sizeof(uint32_t)); i++)
+    {
+        if (save)
+            font[i] = vram[i];
+        else
+            vram[i] = font[i];
+    }
+    // back to the text mode settings from the register table
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MAP_MASK, vga_text_regs[1 + 2]);
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MEM_MODE, vga_text_regs[1 + 4]);
+    for(uint8_t i=VGA_GC_READ_MAP; i<=VGA_GC_MISC; i++)
+    {
+        vga_write_reg(VGA_GC_IDX_PORT, i,
+            vga_text_regs[1 + VGA_REGS_SEQ + VGA_REGS_CRTC + i]);
+    }
+}
+
+/*
+** Saves the text mode font and colors, which graphics modes draw over. Only the
+** first call does anything; call it while still in text mode
+*/
+void vga_text_save(void)
+{
+    if (vga_text_saved)
+        return;
+    vga_text_saved = true;
+    __vga_font_copy(true);
+    uint8_t* dac = MEM_FAR(uint8_t, MEM_TEXT_DAC);
+    _outb(VGA_DAC_READ_PORT, 0);
+    for(uint16_t i=0; i<(3 * VGA_TEXT_DAC_SIZE); i++)
+        dac[i] = _inb(VGA_DAC_DATA_PORT);
+}
+
+/*
+** Switches back to 80x25 text mode (with the cursor hidden) without the BIOS,
+** restoring the font and colors saved by vga_text_save()
+*/
+void vga_text_enter(void)
+{
+    vga_write_regs(vga_text_regs);
+    if (!vga_text_saved)
+        return;
+    __vga_font_copy(false);
+    uint8_t* dac = MEM_FAR(uint8_t, MEM_TEXT_DAC);
+    _outb(VGA_DAC_WRITE_PORT, 0);
+    for(uint16_t i=0; i<(3 * VGA_TEXT_DAC_SIZE); i++)
+        _outb(VGA_DAC_DATA_PORT, dac[i]);
+}
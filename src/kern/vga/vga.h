@@ -15,7 +15,81 @@
 /** Macros     **/
 // identifiers for the various graphics modes
 #define VGA_MODE_TEXT    0x03
+#define VGA_MODE_CGA4    0x04
+#define VGA_MODE_CGA5    0x05
+#define VGA_MODE_12      0x12
 #define VGA_MODE_13      0x13
+// not a BIOS mode; Mode 13h "unchained" into 4 planes ('X')
+#define VGA_MODE_X       0x58
+// not a BIOS mode; whichever VESA BIOS Extensions mode fits the driver ('V')
+#define VGA_MODE_VBE     0x56
+// flag OR'd into a mode to keep what was on the screen the last time the mode
+// was left (video memory and palette), instead of starting from a clear screen
+#define VGA_MODE_KEEP_VRAM  0x80
+#define VGA_MODE_MASK       0x7F
+
+// VGA register ports. Most are index/data pairs: write the register index to
+// the first port, then access the register through the second
+#define VGA_MISC_OUT_PORT   0x3C2
+#define VGA_SEQ_IDX_PORT    0x3C4
+#define VGA_SEQ_DATA_PORT   0x3C5
+#define VGA_GC_IDX_PORT     0x3CE
+#define VGA_GC_DATA_PORT    0x3CF
+#define VGA_CRTC_IDX_PORT   0x3D4
+#define VGA_CRTC_DATA_PORT  0x3D5
+// input status; bit 0 is set during blanking, bit 3 during vertical retrace
+#define VGA_STATUS_PORT     0x3DA
+// common register indices
+#define VGA_SEQ_MAP_MASK    0x02
+#define VGA_SEQ_MEM_MODE    0x04
+#define VGA_GC_READ_MAP     0x04
+#define VGA_GC_MODE         0x05
+#define VGA_GC_BIT_MASK     0x08
+#define VGA_CRTC_START_HI   0x0C
+#define VGA_CRTC_START_LO   0x0D
+#define VGA_GC_MISC         0x06
+// attribute controller; index and data are written to the same port, with
+// a flip-flop (reset by reading the status port) tracking which is next
+#define VGA_AC_PORT         0x3C0
+// set in the index to hand the palette back to the display
+#define VGA_AC_ENABLE       0x20
+// DAC ports; the index auto-increments after every third color byte
+#define VGA_DAC_READ_PORT   0x3C7
+#define VGA_DAC_WRITE_PORT  0x3C8
+#define VGA_DAC_DATA_PORT   0x3C9
+
+// A mode's register table: the misc output register, then the sequencer,
+// CRTC, graphics controller and attribute controller registers in order
+#define VGA_REGS_SEQ        5
+#define VGA_REGS_CRTC       25
+#define VGA_REGS_GC         9
+#define VGA_REGS_AC         21
+#define VGA_REGS_SIZE       (1 + VGA_REGS_SEQ + VGA_REGS_CRTC + VGA_REGS_GC \
+                            + VGA_REGS_AC)
+
+// text mode font: 256 characters, with 32 bytes reserved per character
+#define VGA_FONT_SIZE       (256 * 32)
+// number of DAC entries that the 16 text colors are mapped to
+#define VGA_TEXT_DAC_SIZE   64
+
+// most areas a dirty list tracks before it starts merging them together
+#define VGA_DIRTY_MAX       16
+
+// vga_blit_row() key that leaves no pixel transparent
+#define VGA_BLIT_OPAQUE     0xFFFF
+// vga_blit_mask() background that leaves clear bits alone
+#define VGA_BLIT_CLEAR      0xFFFF
+// vga_alloc_ramp() result when there is no room for the ramp
+#define VGA_RAMP_NONE       0xFFFF
+
+// checks if a pixel lies inside of the clip rectangle
+#define VGA_CLIP_POINT(x, y) \
+    (((x) >= vga_clip.x0) && ((x) < vga_clip.x1) \
+    && ((y) >= vga_clip.y0) && ((y) < vga_clip.y1))
+// checks if a pixel lies on the screen; pixels outside of the clip rectangle
+// can still be read
+#define VGA_SCREEN_POINT(x, y) \
+    (((x) < vga_screen.x1) && ((y) < vga_screen.y1))
 
 /** Structures **/
 // RGB color systems
@@ -26,6 +100,23 @@ typedef struct RGB_8
     uint8_t b;
 } RGB_8;
 
+// screen area; the upper-left corner is inclusive, the lower-right exclusive
+typedef struct VGA_Rect
+{
+    uint16_t x0;
+    uint16_t y0;
+    uint16_t x1;
+    uint16_t y1;
+} VGA_Rect;
+
+// areas of the screen that have changed. Overlapping and touching areas are
+// merged as they are added
+typedef struct VGA_Dirty
+{
+    VGA_Rect rect[VGA_DIRTY_MAX];
+    uint8_t cnt;
+} VGA_Dirty;
+
 // defines a standard set of operations for VGA drivers
 typedef struct VGA_Driver VGA_Driver;
 struct VGA_Driver
@@ -37,6 +128,8 @@ struct VGA_Driver
     uint16_t* frame_buff;
     // remember what graphical mode we are in
     uint8_t vga_mode;
+    // flags the mode was requested with (VGA_MODE_KEEP_VRAM)
+    uint8_t vga_flags;
 
     /*
     ** Start a VGA mode
@@ -45,6 +138,12 @@ struct VGA_Driver
     */
     void (*vga_enter)(VGA_Driver* driver);
 
+    /*
+    ** Leave a VGA mode. Drivers that support VGA_MODE_KEEP_VRAM save what
+    ** they need here. May be NULL
+    */
+    void (*vga_exit)(void);
+
     /*
     ** Clears the video buffer
     */
@@ -55,21 +154,65 @@ struct VGA_Driver
     */
     void (*vga_vsync)(void);
 
+    /*
+    ** Pushes pending work (i.e. palette changes) out to the display. Drivers
+    ** may defer hardware updates until this, or a V-Sync, is called
+    */
+    void (*vga_present)(void);
+
+    /*
+    ** Looks up the color code that draws a color, adding the color to the
+    ** palette if there is room (or picking the closest one if there isn't).
+    ** Codes stay valid at least until the screen is next cleared
+    **
+    ** @param color RGB color
+    ** @return Color code to draw with
+    */
+    uint8_t (*vga_fetch_color)(RGB_8 color);
+
+    /*
+    ** Keeps a color code valid across screen clears, or lets it go again.
+    ** Pins are counted. May be NULL if color codes never change
+    **
+    ** @param color_code Color code from vga_fetch_color
+    ** @param pin True to pin, false to undo an earlier pin
+    */
+    void (*vga_pin_color)(uint8_t color_code, bool pin);
+
+    /*
+    ** Reserves a run of consecutive color codes that fade evenly from one
+    ** color to another. May be NULL if the mode can't set its own colors
+    **
+    ** @param c0 Color of the first code
+    ** @param c1 Color of the last code
+    ** @param n Number of codes in the ramp
+    ** @return First color code of the ramp or VGA_RAMP_NONE
+    */
+    uint16_t (*vga_alloc_ramp)(RGB_8 c0, RGB_8 c1, uint8_t n);
+
+    /*
+    ** Lets go of a ramp from vga_alloc_ramp. May be NULL
+    **
+    ** @param color_code First color code of the ramp
+    */
+    void (*vga_free_ramp)(uint8_t color_code);
+
     /*
     ** Write a pixel out to the frame buffer. This represents a single pixel
     **
     ** @param x coordinate on the screen
     ** @param y coordinate on the screen
-    ** @param color Pixel color to write
+    ** @param color_code Color code to write
     */
-    void (*vga_put_pixel)(uint16_t x, uint16_t y, RGB_8 color);
+    void (*vga_put_pixel)(uint16_t x, uint16_t y, uint8_t color_code);
 
     /*
     ** Read a pixel out of the frame buffer. This represents a single pixel
     **
     ** @param x coordinate on the screen
     ** @param y coordinate on the screen
-    ** @param color Pixel color written to the pixel position
+    ** @param color Pixel color written to the pixel position; black when the
+    **        pixel is off the screen
     */
     void (*vga_get_pixel)(uint16_t x, uint16_t y, RGB_8* color);
 
@@ -80,10 +223,10 @@ struct VGA_Driver
     ** @param ury Upper-right y coordinate on the screen
     ** @param llx Lower-left x coordinate on the screen
     ** @param lly Lower-left y coordinate on the screen
-    ** @param color Pixel color to write
+    ** @param color_code Color code to write
     */
     void (*vga_draw_rect)(uint16_t urx, uint16_t ury, uint16_t llx,
-        uint16_t lly, RGB_8 color);
+        uint16_t lly, uint8_t color_code);
 
     /*
     ** Draws a simple rectangle, using alternative parameter listings
@@ -92,15 +235,95 @@ struct VGA_Driver
     ** @param uly Upper-left y coordinate on the screen
     ** @param w Width of the rectangle
     ** @param h Height of the rectangle
-    ** @param color Pixel color to write
+    ** @param color_code Color code to write
     */
     void (*vga_draw_rect_wh)(uint16_t ulx, uint16_t uly, uint16_t w,
-        uint16_t h, RGB_8 color);
+        uint16_t h, uint8_t color_code);
+
+    /*
+    ** Draws a horizontal run of pixels
+    **
+    ** @param x Left-most x coordinate on the screen
+    ** @param y coordinate on the screen
+    ** @param w Number of pixels to draw
+    ** @param color_code Color code to write
+    */
+    void (*vga_hspan)(uint16_t x, uint16_t y, uint16_t w, uint8_t color_code);
 
+    /*
+    ** Draws a vertical run of pixels
+    **
+    ** @param x coordinate on the screen
+    ** @param y Top-most y coordinate on the screen
+    ** @param h Number of pixels to draw
+    ** @param color_code Color code to write
+    */
+    void (*vga_vspan)(uint16_t x, uint16_t y, uint16_t h, uint8_t color_code);
+
+    /*
+    ** Draws a row of pixels given as indices into a caller-supplied palette
+    **
+    ** @param x Left-most x coordinate on the screen
+    ** @param y coordinate on the screen
+    ** @param w Number of pixels in the row
+    ** @param idx Palette index of each pixel
+    ** @param pal Palette the indices refer to, as color codes
+    ** @param key Index that is left transparent, VGA_BLIT_OPAQUE for none
+    */
+    void (*vga_blit_row)(uint16_t x, uint16_t y, uint16_t w,
+        const uint8_t* idx, const uint8_t* pal, uint16_t key);
+
+    /*
+    ** Draws a 1 bit-per-pixel mask; set bits are drawn in one color and clear
+    ** bits in another, or left alone. The most significant bit is the
+    ** left-most pixel
+    **
+    ** @param x Left-most x coordinate on the screen
+    ** @param y Top-most y coordinate on the screen
+    ** @param w Width of the mask, in pixels
+    ** @param h Height of the mask, in pixels
+    ** @param bits Mask rows
+    ** @param stride Number of bytes between the start of each mask row
+    ** @param color_code Color code to write for set bits
+    ** @param bg_code Color code to write for clear bits, VGA_BLIT_CLEAR to
+    **        leave them alone
+    */
+    void (*vga_blit_mask)(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+        const uint8_t* bits, uint16_t stride, uint8_t color_code,
+        uint16_t bg_code);
+
+    /*
+    ** Copies one area of the screen to another. The areas may overlap
+    **
+    ** @param sx Upper-left x coordinate to copy from
+    ** @param sy Upper-left y coordinate to copy from
+    ** @param dx Upper-left x coordinate to copy to
+    ** @param dy Upper-left y coordinate to copy to
+    ** @param w Width of the area
+    ** @param h Height of the area
+    */
+    void (*vga_copy_rect)(uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy,
+        uint16_t w, uint16_t h);
+
+    /*
+    ** Switches drawing between video memory and a back buffer in system
+    ** memory. While the back buffer is in use, vga_present copies the parts
+    ** of it that changed out to the screen. May be NULL
+    **
+    ** @param enable True to draw to the back buffer, false to draw directly
+    **        to the screen again
+    */
+    void (*vga_back_buffer)(bool enable);
 };
 
 /** Globals    **/
 
+// area that drivers are allowed to draw in. Every drawing operation is clipped
+// to it once, up front, so the inner loops never need to check bounds
+extern VGA_Rect vga_clip;
+// the whole screen of the current mode; copies only read from inside of it
+extern VGA_Rect vga_screen;
+
 /** Functions  **/
 
 /*
@@ -112,4 +335,139 @@ struct VGA_Driver
 */
 bool vga_RGB_8_cmp(RGB_8 c0, RGB_8 c1);
 
+/*
+** Perceptually weighted distance between two colors (the eye is most
+** sensitive to green, then red, then blue)
+**
+** @param c0 First color
+** @param c1 Second color
+** @return Squared, weighted distance
+*/
+uint32_t vga_RGB_8_dist(RGB_8 c0, RGB_8 c1);
+
+/*
+** Picks a color on the line between two colors
+**
+** @param c0 First color
+** @param c1 Last color
+** @param k Step to pick; 0 is c0 and n - 1 is c1
+** @param n Number of evenly spaced steps from c0 to c1
+** @return Color of step k
+*/
+RGB_8 vga_RGB_8_step(RGB_8 c0, RGB_8 c1, uint8_t k, uint8_t n);
+
+/*
+** Waits for the start of the next vertical retrace
+*/
+void vga_wait_retrace(void);
+
+/*
+** Writes to an indexed VGA register (sequencer, graphics controller, CRTC)
+**
+** @param port Index port of the register group
+** @param idx Register index
+** @param val Value to write
+*/
+void vga_write_reg(uint16_t port, uint8_t idx, uint8_t val);
+
+/*
+** Reads from an indexed VGA register (sequencer, graphics controller, CRTC)
+**
+** @param port Index port of the register group
+** @param idx Register index
+** @return Register value
+*/
+uint8_t vga_read_reg(uint16_t port, uint8_t idx);
+
+/*
+** Fills a run of 8-bit pixels in video memory. Bulk of the run is written with
+** 32-bit stores
+**
+** @param addr Address of the first pixel
+** @param n Number of pixels to fill
+** @param color_code Palette index to fill with
+*/
+void vga_fill_span(uint8_t* addr, uint32_t n, uint8_t color_code);
+
+/*
+** Clips a rectangle to the clip rectangle. The upper-left corner may be left
+** of or above the screen, as a negative number; x1 and y1 may be worked out as
+** x0 plus the width (or height) in 16 bits, wrapping around
+**
+** @param x0 Left-most x coordinate (inclusive), updated in place
+** @param y0 Top-most y coordinate (inclusive), updated in place
+** @param x1 Right-most x coordinate (exclusive), updated in place
+** @param y1 Bottom-most y coordinate (exclusive), updated in place
+** @return False if nothing is left to draw
+*/
+bool vga_clip_rect(uint16_t* x0, uint16_t* y0, uint16_t* x1, uint16_t* y1);
+
+/*
+** Clips the destination of a screen-to-screen copy to the clip rectangle and
+** the source to the screen, moving the other side along with each
+**
+** @param sx Upper-left x coordinate to copy from, updated in place
+** @param sy Upper-left y coordinate to copy from, updated in place
+** @param dx Upper-left x coordinate to copy to, updated in place
+** @param dy Upper-left y coordinate to copy to, updated in place
+** @param w Width of the area, updated in place
+** @param h Height of the area, updated in place
+** @return False if nothing is left to copy
+*/
+bool vga_clip_copy(uint16_t* sx, uint16_t* sy, uint16_t* dx, uint16_t* dy,
+    uint16_t* w, uint16_t* h);
+
+/*
+** Copies a run of 8-bit pixels. Bulk of the run is copied with 32-bit moves
+** when both sides line up the same way
+**
+** @param dst Address of the first pixel to write
+** @param src Address of the first pixel to read
+** @param n Number of pixels to copy
+*/
+void vga_copy_span(uint8_t* dst, const uint8_t* src, uint32_t n);
+
+/*
+** Adds an area to a dirty list. Areas that overlap or touch ones already in
+** the list are merged with them. Once the list is full, the new area is merged
+** with whichever area it grows the least
+**
+** @param dirty Dirty list
+** @param x0 Left-most x coordinate (inclusive)
+** @param y0 Top-most y coordinate (inclusive)
+** @param x1 Right-most x coordinate (exclusive)
+** @param y1 Bottom-most y coordinate (exclusive)
+*/
+void vga_dirty_add(VGA_Dirty* dirty, uint16_t x0, uint16_t y0, uint16_t x1,
+    uint16_t y1);
+
+/*
+** Fills in the span, blit and copy operations of a driver with generic
+** versions built on top of the driver's own pixel and rectangle functions.
+** Drivers without faster versions of their own call this when entering
+**
+** @param driver Driver, with the pixel and rectangle functions already set
+*/
+void vga_generic_ops(VGA_Driver* driver);
+
+/*
+** Programs a full set of VGA registers, switching modes without the BIOS.
+** Video memory is left as is
+**
+** @param regs Register table (VGA_REGS_SIZE bytes)
+*/
+void vga_write_regs(const uint8_t* regs);
+
+/*
+** Saves the text mode font and colors, which graphics modes draw over. Only the
+** first call does anything; call it while still in text mode
+*/
+void vga_text_save(void);
+
+/*
+** Switches back to 80x25 text mode (with the cursor hidden) without the BIOS,
+** restoring the font and colors saved by vga_text_save()
+*/
+void vga_text_enter(void);
+
 #endif
@@ -0,0 +1,339 @@
+/*
+** File:    vga12.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Driver for VGA's "Mode 12h" graphics mode
+**              640x480 with 16 colors, stored as 4 bit planes. Writes use
+**              write mode 2, where the CPU byte is the color and the bit mask
+**              register picks which of the byte's 8 pixels get it. This driver
+**              keeps its own 16 color palette, filled in on the fly
+*/
+
+/** Headers    **/
+#include "../gcc16.h"
+#include "../asm_lib.h"
+#include "vga12.h"
+// shares the DAC ports with Mode 13h
+#include "vga13.h"
+
+/** Macros     **/
+// GC mode register values
+#define VGA12_GC_MODE_READ  0x00
+#define VGA12_GC_MODE_WRITE 0x02
+
+/** Globals    **/
+// Palette look-up table. Reserved: black and white
+static RGB_8 vga12_palette[VGA12_PALETTE_SIZE];
+// next palette entry that has never been handed out
+static uint8_t vga12_idx;
+// recency tracking, same scheme as the Mode 13h palette: entries stamped
+// after the last screen clear may be on screen and are never recycled
+static uint32_t vga12_tick;
+static uint32_t vga12_stamp[VGA12_PALETTE_SIZE];
+static uint32_t vga12_epoch;
+// number of pins on each entry; pinned entries are never recycled
+static uint8_t vga12_pin[VGA12_PALETTE_SIZE];
+
+/************************** Palette Functions **************************/
+
+/*
+** Sets a color in the palette table; goes straight to the DAC
+**
+** @param idx Index of the value to set (0-15)
+** @param color RGB color value to set
+*/
+static void __vga12_set_color(uint8_t idx, RGB_8 color)
+{
+    vga12_palette[idx] = color;
+    _outb(VGA13_PALETTE_PORT_IDX, idx);
+    // 6 bits per channel
+    _outb(VGA13_PALETTE_PORT_CLR, color.r >> 2);
+    _outb(VGA13_PALETTE_PORT_CLR, color.g >> 2);
+    _outb(VGA13_PALETTE_PORT_CLR, color.b >> 2);
+}
+
+/*
+** Fetchs a color in the palette. If a match is not found, the color is added
+** to the table, recycling the least recently used entry that is not on the
+** screen. If every entry may be on screen, the closest color is used instead
+**
+** @param color RGB Color to set
+** @return Look up value in the color palette table. To write to frame buffer
+*/
+static uint8_t __vga12_fetch_color(RGB_8 color)
+{
+    ++vga12_tick;
+    uint8_t best = VGA12_PALETTE_BLACK;
+    uint32_t best_val = 0xFFFFFFFF;
+    for(uint8_t i=0; i<VGA12_PALETTE_SIZE; i++)
+    {
+        if (((i < vga12_idx) || (i == VGA12_PALETTE_WHITE))
+            && vga_RGB_8_cmp(color, vga12_palette[i]))
+        {
+            vga12_stamp[i] = vga12_tick;
+            return i;
+        }
+    }
+    if (vga12_idx < VGA12_PALETTE_WHITE)
+        best = vga12_idx++;
+    else
+    {
+        // oldest entry not used since the last clear (black/white are fixed)
+        for(uint8_t i=1; i<VGA12_PALETTE_WHITE; i++)
+        {
+            if ((vga12_stamp[i] <= vga12_epoch) && (vga12_stamp[i] < best_val)
+                && (vga12_pin[i] == 0))
+            {
+                best = i;
+                best_val = vga12_stamp[i];
+            }
+        }
+        if (best == VGA12_PALETTE_BLACK)
+        {
+            for(uint8_t i=0; i<VGA12_PALETTE_SIZE; i++)
+            {
+                uint32_t dist = vga_RGB_8_dist(color, vga12_palette[i]);
+                if (dist < best_val)
+                {
+                    best = i;
+                    best_val = dist;
+                }
+            }
+            return best;
+        }
+    }
+    __vga12_set_color(best, color);
+    vga12_stamp[best] = vga12_tick;
+    return best;
+}
+
+/*
+** Pins a palette entry so it is never recycled, even after the screen is
+** cleared, or undoes an earlier pin
+**
+** @param idx Palette index
+** @param pin True to pin, false to undo an earlier pin
+*/
+static void __vga12_pin_color(uint8_t idx, bool pin)
+{
+    if (pin)
+        ++vga12_pin[idx];
+    else if (vga12_pin[idx] > 0)
+        --vga12_pin[idx];
+}
+
+/*
+** Initializes the color palette
+*/
+static void __vga12_init_color(void)
+{
+    // make pixel values index the DAC directly; the BIOS default maps some of
+    // them to the EGA-compatible DAC entries
+    _inb(VGA_STATUS_PORT);
+    for(uint8_t i=0; i<VGA12_PALETTE_SIZE; i++)
+    {
+        _outb(VGA12_AC_PORT, i);
+        _outb(VGA12_AC_PORT, i);
+    }
+    _outb(VGA12_AC_PORT, VGA12_AC_ENABLE);
+    vga12_tick = 0;
+    vga12_epoch = 0;
+    for(uint8_t i=0; i<VGA12_PALETTE_SIZE; i++)
+    {
+        vga12_stamp[i] = 0;
+        vga12_pin[i] = 0;
+    }
+    __vga12_set_color(VGA12_PALETTE_BLACK, (RGB_8){  0,   0,   0});
+    __vga12_set_color(VGA12_PALETTE_WHITE, (RGB_8){255, 255, 255});
+    vga12_idx = VGA12_PALETTE_BLACK + 1;
+}
+
+/************************** Draw Functions **************************/
+
+/*
+** Fills a block on the screen with the same pixels of every byte column
+**
+** @param addr Address of the upper-left byte
+** @param w Width of the block, in bytes
+** @param h Height of the block, in scanlines
+** @param mask Bit mask of the pixels to set in each byte
+** @param color_code Palette index to fill with
+*/
+static void __vga12_fill(uint8_t* addr, uint16_t w, uint16_t h, uint8_t mask,
+    uint8_t color_code)
+{
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_BIT_MASK, mask);
+    for(; h>0; h--)
+    {
+        if (mask == 0xFF)
+            // whole bytes; 32 pixels per store
+            vga_fill_span(addr, w, color_code);
+        else
+        {
+            // load the latches so the masked-off pixels are written back
+            *((volatile uint8_t*)addr);
+            *addr = color_code;
+        }
+        addr += VGA12_ROW_SIZE;
+    }
+}
+
+/*
+** Clears the video buffer
+*/
+static void __vga12_clrscr(void)
+{
+    vga12_epoch = vga12_tick;
+    __vga12_fill((uint8_t*)VGA12_MEM_BEGIN, VGA12_MEM_SIZE, 1, 0xFF, 0);
+}
+
+/*
+** Vertical sync control. Useful for slow electron-gun-based displays
+*/
+static void __vga12_vsync(void)
+{
+    vga_wait_retrace();
+}
+
+/*
+** Pushes pending changes out to the display. Palette changes are made right
+** away in this mode, so there is nothing to do
+*/
+static void __vga12_present(void)
+{
+}
+
+/*
+** Write a pixel out to the frame buffer. This represents a single pixel
+**
+** @param x coordinate on the screen
+** @param y coordinate on the screen
+** @param color_code Color code to write
+*/
+static void __vga12_put_pixel(uint16_t x, uint16_t y, uint8_t color_code)
+{
+    if (!VGA_CLIP_POINT(x, y))
+        return;
+    __vga12_fill((uint8_t*)(VGA12_MEM_BEGIN + (y * VGA12_ROW_SIZE) + (x >> 3)),
+        1, 1, 0x80 >> (x & 7), color_code);
+}
+
+/*
+** Read a pixel out of the frame buffer. This represents a single pixel
+**
+** @param x coordinate on the screen
+** @param y coordinate on the screen
+** @param color Pixel color written to the pixel position; black when the
+**        pixel is off the screen
+*/
+static void __vga12_get_pixel(uint16_t x, uint16_t y, RGB_8* color)
+{
+    if (!VGA_SCREEN_POINT(x, y))
+    {
+        *color = (RGB_8){0, 0, 0};
+        return;
+    }
+    volatile uint8_t* addr =
+        (uint8_t*)(VGA12_MEM_BEGIN + (y * VGA12_ROW_SIZE) + (x >> 3));
+    uint8_t shift = 7 - (x & 7);
+    uint8_t color_code = 0;
+    // gather one bit from each plane
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_MODE, VGA12_GC_MODE_READ);
+    for(uint8_t plane=0; plane<4; plane++)
+    {
+        vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_READ_MAP, plane);
+        color_code |= ((*addr >> shift) & 1) << plane;
+    }
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_MODE, VGA12_GC_MODE_WRITE);
+    *color = vga12_palette[color_code];
+}
+
+/*
+** Draws a simple rectangle. Inner bytes set 8 pixels at once; only the partial
+** bytes on either end need a bit mask
+**
+** @param urx Upper-right x coordinate on the screen
+** @param ury Upper-right y coordinate on the screen
+** @param llx Lower-left x coordinate on the screen
+** @param lly Lower-left y coordinate on the screen
+** @param color_code Color code to write
+*/
+static void __vga12_draw_rect(uint16_t urx, uint16_t ury, uint16_t llx,
+    uint16_t lly, uint8_t color_code)
+{
+    if (!vga_clip_rect(&llx, &ury, &urx, &lly))
+        return;
+    uint16_t h = lly - ury;
+    uint8_t* row = (uint8_t*)(VGA12_MEM_BEGIN + (ury * VGA12_ROW_SIZE));
+    // byte columns holding the first and last pixels
+    uint16_t col0 = llx >> 3;
+    uint16_t col1 = (urx - 1) >> 3;
+    uint8_t l_mask = 0xFF >> (llx & 7);
+    uint8_t r_mask = 0xFF << (7 - ((urx - 1) & 7));
+    if (col0 == col1)
+    {
+        __vga12_fill(row + col0, 1, h, l_mask & r_mask, color_code);
+        return;
+    }
+    __vga12_fill(row + col0, 1, h, l_mask, color_code);
+    if ((col1 - col0) > 1)
+        __vga12_fill(row + col0 + 1, col1 - col0 - 1, h, 0xFF, color_code);
+    __vga12_fill(row + col1, 1, h, r_mask, color_code);
+}
+
+/*
+** Draws a simple rectangle, using alternative parameter listings
+**
+** @param ulx Upper-left x coordinate on the screen
+** @param uly Upper-left y coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param color_code Color code to write
+*/
+static void __vga12_draw_rect_wh(uint16_t ulx, uint16_t uly, uint16_t w,
+    uint16_t h, uint8_t color_code)
+{
+    __vga12_draw_rect(ulx + w, uly, ulx, uly + h, color_code);
+}
+
+/************************** GL-Visible Functions **************************/
+
+/*
+** Start VGA's Mode12h
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _vga12_enter(VGA_Driver* driver)
+{
+    driver->screen_w = VGA12_WIDTH;
+    driver->screen_h = VGA12_HEIGHT;
+    driver->frame_buff = (uint16_t*)VGA12_MEM_BEGIN;
+    driver->vga_mode = VGA_MODE_12;
+    // set all the functions here
+    driver->vga_enter = &_vga12_enter;
+    driver->vga_exit = NULL;
+    driver->vga_clrscr = &__vga12_clrscr;
+    driver->vga_vsync = &__vga12_vsync;
+    driver->vga_present = &__vga12_present;
+    driver->vga_fetch_color = &__vga12_fetch_color;
+    driver->vga_pin_color = &__vga12_pin_color;
+    driver->vga_alloc_ramp = NULL;
+    driver->vga_free_ramp = NULL;
+    driver->vga_put_pixel = &__vga12_put_pixel;
+    driver->vga_get_pixel = &__vga12_get_pixel;
+    driver->vga_draw_rect = &__vga12_draw_rect;
+    driver->vga_draw_rect_wh = &__vga12_draw_rect_wh;
+    // spans, blits and copies are built on the functions above
+    vga_generic_ops(driver);
+    driver->vga_back_buffer = NULL;
+
+    // BIOS interrupt appears to clear memory on reset
+    __asm__ __volatile__("movb $0x12, %al\n");
+    __asm__ __volatile__("movb $0x00, %ah\n");
+    __asm__ __volatile__("int  $0x10\n");
+    // every write goes through write mode 2 to all four planes
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MAP_MASK, 0x0F);
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_MODE, VGA12_GC_MODE_WRITE);
+    __vga12_init_color();
+}
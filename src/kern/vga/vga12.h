@@ -0,0 +1,50 @@
+/*
+** File:    vga12.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Driver for VGA's "Mode 12h" graphics mode
+**              640x480 with 16 colors, stored as 4 bit planes. Writes use
+**              write mode 2, where the CPU byte is the color and the bit mask
+**              register picks which of the byte's 8 pixels get it. This driver
+**              keeps its own 16 color palette, filled in on the fly
+*/
+#ifndef _VGA12_H_
+#define _VGA12_H_
+
+/** Headers    **/
+#include "../gcc16.h"
+#include "../types.h"
+// standard header for VGA drivers
+#include "vga.h"
+
+/** Macros     **/
+// Graphics mode screen dimensions (1 bit per pixel in each plane)
+#define VGA12_WIDTH         640
+#define VGA12_HEIGHT        480
+#define VGA12_ROW_SIZE      (VGA12_WIDTH / 8)
+#define VGA12_MEM_SIZE      (VGA12_ROW_SIZE * VGA12_HEIGHT)
+#define VGA12_MEM_BEGIN     0xA0000
+
+// size of Mode12h palette (color look-up table)
+#define VGA12_PALETTE_SIZE  16
+// reserved colors
+#define VGA12_PALETTE_BLACK 0
+#define VGA12_PALETTE_WHITE (VGA12_PALETTE_SIZE - 1)
+
+// attribute controller; index and data are written to the same port, with
+// a flip-flop (reset by reading the status port) tracking which is next
+#define VGA12_AC_PORT       0x3C0
+// set in the index to hand the palette back to the display
+#define VGA12_AC_ENABLE     0x20
+
+/** Functions  **/
+
+/*
+** Start VGA's Mode12h
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _vga12_enter(VGA_Driver* driver);
+
+#endif
@@ -11,38 +11,293 @@
 /** Headers    **/
 #include "../gcc16.h"
 #include "../asm_lib.h"
+#include "../mem_map.h"
 #include "vga13.h"
 
-// Palette look-up table in memory. Should be faster to use than Port I/O
-// Reserved:
+/** Macros     **/
+// address of a pixel in the buffer being drawn to
+#define VGA13_PIXEL(x, y) \
+    (vga13_fb + VGA13_ROW[y] + (x))
+// video memory and the back buffer
+#define VGA13_VRAM      ((uint8_t*)VGA13_MEM_BEGIN)
+#define VGA13_BACK      MEM_FAR(uint8_t, MEM_VGA13_BACK)
+// Palette look-up table in memory. Should be faster to use than Port I/O.
+// This and the other per-entry tables are kept out of the first 64kB
+#define VGA13_COLORS    MEM_FAR(RGB_8, MEM_VGA13_PALETTE)
+// hash chain links, see palette_hash
+#define VGA13_NEXT      MEM_FAR(uint8_t, MEM_VGA13_NEXT)
+// tick each palette entry was last used at, see palette_tick
+#define VGA13_STAMP     MEM_FAR(uint32_t, MEM_VGA13_STAMP)
+// pinned entries are never evicted (reserved colors are pinned for good).
+// Holds the number of pins on each entry
+#define VGA13_PIN       MEM_FAR(uint8_t, MEM_VGA13_PIN)
+// quantized RGB -> nearest palette entry, filled in lazily once the palette
+// runs out of room. A bit set in VGA13_INV_VALID marks a cell as filled in
+#define VGA13_INV_MAP   MEM_FAR(uint8_t, MEM_VGA13_INV_MAP)
+#define VGA13_INV_VALID MEM_FAR(uint8_t, MEM_VGA13_INV_VALID)
+// offset of the start of each scanline, so addressing a pixel needs no multiply
+#define VGA13_ROW       MEM_FAR(uint16_t, MEM_VGA13_ROW)
+
+// Reserved palette colors:
 //   + Black (and Error code)
 //   + White
 static const RGB_8 RGB_8_BLACK = {  0,   0,   0};
 static const RGB_8 RGB_8_WHITE = {255, 255, 255};
-static RGB_8 color_palette[VGA13_PALETTE_SIZE];
-// current index into the table
+// next palette entry that has never been handed out; once this reaches the
+// ramps the table is full and entries have to be recycled
 static uint8_t palette_idx;
+// color ramps take the entries from here up to white. Plain colors are only
+// stored below this
+static uint8_t palette_ramp_lo;
+static VGA13_Ramp palette_ramps[VGA13_RAMPS];
+// RGB -> palette index hash. Each bucket holds the first palette index in a
+// chain and VGA13_NEXT links the rest of the chain. Black is never hashed
+// (it is checked up front), so 0 doubles as the end-of-chain marker
+static uint8_t palette_hash[VGA13_HASH_SIZE];
+// recency tracking; every fetch advances the tick and stamps the entry used
+static uint32_t palette_tick;
+// tick of the last screen clear. Entries stamped after this may be on screen
+// and are never recycled
+static uint32_t palette_epoch;
+// last color fetched; draw loops tend to ask for the same color repeatedly
+static RGB_8 palette_last;
+static uint8_t palette_last_code;
+// range of shadow palette entries that have not been sent to the DAC yet
+static uint8_t palette_dirty_lo;
+static uint8_t palette_dirty_hi;
+// number of VGA13_INV_MAP cells filled in
+static uint16_t inv_cnt;
+
+// Mode 13h registers
+static const uint8_t vga13_regs[VGA_REGS_SIZE] =
+{
+    // misc
+    0x63,
+    // sequencer
+    0x03, 0x01, 0x0F, 0x00, 0x0E,
+    // CRTC
+    0x5F, 0x4F, 0x50, 0x82, 0x54, 0x80, 0xBF, 0x1F,
+    0x00, 0x41, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x9C, 0x0E, 0x8F, 0x28, 0x40, 0x96, 0xB9, 0xA3, 0xFF,
+    // graphics controller
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x05, 0x0F, 0xFF,
+    // attribute controller
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x41, 0x00, 0x0F, 0x00, 0x00,
+};
+// set while MEM_VGA13_SAVE holds the screen (and the palette still matches)
+static bool vga13_saved;
+// set when the mode was entered with VGA_MODE_KEEP_VRAM; the screen is only
+// saved on the way out for those callers
+static bool vga13_keep;
+// buffer that is drawn to; video memory, unless the back buffer is in use
+static uint8_t* vga13_fb;
+// areas of the back buffer that haven't been copied to the screen yet
+static VGA_Dirty vga13_dirty;
+// 4 mask bits -> 4 pixels. The left-most pixel (most significant bit) is the
+// lowest address, so it lands in the low byte of the 32-bit store
+static const uint32_t vga13_nibble[16] =
+{
+    0x00000000, 0xFF000000, 0x00FF0000, 0xFFFF0000,
+    0x0000FF00, 0xFF00FF00, 0x00FFFF00, 0xFFFFFF00,
+    0x000000FF, 0xFF0000FF, 0x00FF00FF, 0xFFFF00FF,
+    0x0000FFFF, 0xFF00FFFF, 0x00FFFFFF, 0xFFFFFFFF,
+};
 
 /************************** Palette Functions **************************/
 
 /*
-** Sets the color value in the palette (look-up table) on the VGA controller
-** using Port I/O
+** Queues a palette entry to be uploaded to the VGA controller. Entries are
+** only tracked as a dirty range here; the port I/O happens in one burst when
+** the palette is flushed
 **
 ** @param idx Index of the value to set (0-255)
 ** @param color RGB color value to set
 */
-static void __vga13_set_port_color(uint8_t idx, RGB_8 color)
+static void __vga13_set_shadow_color(uint8_t idx, RGB_8 color)
+{
+    VGA13_COLORS[idx] = color;
+    if (palette_dirty_lo > palette_dirty_hi)
+    {
+        palette_dirty_lo = idx;
+        palette_dirty_hi = idx;
+    }
+    else if (idx < palette_dirty_lo)
+        palette_dirty_lo = idx;
+    else if (idx > palette_dirty_hi)
+        palette_dirty_hi = idx;
+}
+
+/*
+** Uploads the dirty range of the shadow palette to the VGA controller using
+** Port I/O. The index is only written once; the DAC auto-increments after
+** every third color byte
+*/
+void _vga13_flush_palette(void)
+{
+    if (palette_dirty_lo > palette_dirty_hi)
+        return;
+    _outb(VGA13_PALETTE_PORT_IDX, palette_dirty_lo);
+    for (uint16_t i=palette_dirty_lo; i<=palette_dirty_hi; ++i)
+    {
+        // this mode actually only uses 6 bit per channel; 18bit not 24bit
+        // color so right shifting by 2 bits will quantize the color space,
+        // giving a closer approximation of the desired color
+        _outb(VGA13_PALETTE_PORT_CLR, VGA13_COLORS[i].r >> 2);
+        _outb(VGA13_PALETTE_PORT_CLR, VGA13_COLORS[i].g >> 2);
+        _outb(VGA13_PALETTE_PORT_CLR, VGA13_COLORS[i].b >> 2);
+    }
+    // empty range: lo > hi
+    palette_dirty_lo = VGA13_PALETTE_WHITE;
+    palette_dirty_hi = VGA13_PALETTE_BLACK;
+}
+
+/*
+** Hashes a color into a bucket of the palette hash table
+**
+** @param color RGB color to hash
+** @return Bucket index
+*/
+static uint8_t __vga13_hash_color(RGB_8 color)
+{
+    return ((color.r * 7) ^ (color.g * 3) ^ color.b ^ (color.g >> 5))
+        & (VGA13_HASH_SIZE - 1);
+}
+
+/*
+** Removes a palette entry from its hash chain, so it can be reused
+**
+** @param idx Palette index to unlink
+*/
+static void __vga13_unhash_color(uint8_t idx)
+{
+    uint8_t* link = &palette_hash[__vga13_hash_color(VGA13_COLORS[idx])];
+    while (*link != VGA13_PALETTE_NOT_FOUND)
+    {
+        if (*link == idx)
+        {
+            *link = VGA13_NEXT[idx];
+            return;
+        }
+        link = &VGA13_NEXT[*link];
+    }
+}
+
+/*
+** Calculates the center color of an inverse color map cell
+**
+** @param cell Cell index in the inverse color map
+** @return Color at the center of the cell
+*/
+static RGB_8 __vga13_inv_color(uint16_t cell)
+{
+    const uint8_t shift = 8 - VGA13_INV_BITS;
+    const uint8_t mask = (1 << VGA13_INV_BITS) - 1;
+    const uint8_t half = 1 << (shift - 1);
+    RGB_8 color = {
+        ((cell >> (2 * VGA13_INV_BITS)) << shift) + half,
+        (((cell >> VGA13_INV_BITS) & mask) << shift) + half,
+        ((cell & mask) << shift) + half
+    };
+    return color;
+}
+
+/*
+** Maps a color to the closest entry already in the palette. Used when there
+** is no room left to add the color; nothing already drawn is disturbed
+**
+** @param color RGB color to match
+** @return Palette index of the closest color
+*/
+static uint8_t __vga13_nearest_color(RGB_8 color)
+{
+    const uint8_t shift = 8 - VGA13_INV_BITS;
+    uint16_t cell = ((color.r >> shift) << (2 * VGA13_INV_BITS))
+        | ((color.g >> shift) << VGA13_INV_BITS) | (color.b >> shift);
+    if (VGA13_INV_VALID[cell >> 3] & (1 << (cell & 7)))
+        return VGA13_INV_MAP[cell];
+    // first time this cell is needed; search the palette once
+    RGB_8 center = __vga13_inv_color(cell);
+    uint8_t best = VGA13_PALETTE_BLACK;
+    uint32_t best_dist = vga_RGB_8_dist(center, VGA13_COLORS[best]);
+    for (uint16_t i=VGA13_PALETTE_BLACK + 1; i<palette_idx; ++i)
+    {
+        uint32_t dist = vga_RGB_8_dist(center, VGA13_COLORS[i]);
+        if (dist < best_dist)
+        {
+            best = i;
+            best_dist = dist;
+        }
+    }
+    if (vga_RGB_8_dist(center, RGB_8_WHITE) < best_dist)
+        best = VGA13_PALETTE_WHITE;
+    VGA13_INV_MAP[cell] = best;
+    VGA13_INV_VALID[cell >> 3] |= (1 << (cell & 7));
+    ++inv_cnt;
+    return best;
+}
+
+/*
+** Keeps the inverse color map in sync after a palette entry changes color.
+** Cells pointing at the old color are dropped (they get searched again on
+** demand); cells that are closer to the new color are re-pointed at it
+**
+** @param idx Palette index that changed
+*/
+static void __vga13_update_inv(uint8_t idx)
+{
+    if (inv_cnt == 0)
+        return;
+    for (uint16_t cell=0; cell<VGA13_INV_SIZE; ++cell)
+    {
+        uint8_t bit = 1 << (cell & 7);
+        if (!(VGA13_INV_VALID[cell >> 3] & bit))
+            continue;
+        RGB_8 center = __vga13_inv_color(cell);
+        if (VGA13_INV_MAP[cell] == idx)
+        {
+            VGA13_INV_VALID[cell >> 3] &= ~bit;
+            --inv_cnt;
+        }
+        else if (vga_RGB_8_dist(center, VGA13_COLORS[idx])
+            < vga_RGB_8_dist(center, VGA13_COLORS[VGA13_INV_MAP[cell]]))
+        {
+            VGA13_INV_MAP[cell] = idx;
+        }
+    }
+}
+
+/*
+** Picks the palette entry that the next new color will be stored in. Unused
+** entries are handed out first. After that, the least-recently-used entry that
+** is not pinned and has not been used since the screen was last cleared is
+** recycled
+**
+** @return Palette index to (re)use or VGA13_PALETTE_NOT_FOUND if every entry
+**         may still be on screen
+*/
+static uint8_t __vga13_alloc_color(void)
 {
-    // look through the table
-    // RGB values written to the device table/palette, under an index value
-    _outb(VGA13_PALETTE_PORT_IDX, idx);
-    // this mode actually only uses 6 bit per channel; 18bit not 24bit color
-    // so right shifting by 2 bits will quantize the color space, giving a
-    // closer approximation of the desired color
-    _outb(VGA13_PALETTE_PORT_CLR, color.r >> 2);
-    _outb(VGA13_PALETTE_PORT_CLR, color.g >> 2);
-    _outb(VGA13_PALETTE_PORT_CLR, color.b >> 2);
+    if (palette_idx < palette_ramp_lo)
+        return palette_idx++;
+    // the table is full; find the oldest entry. The age is calculated with
+    // unsigned math so that it survives the tick wrapping around
+    uint8_t lru = VGA13_PALETTE_NOT_FOUND;
+    // anything younger than the last clear could still be visible
+    uint32_t lru_age = palette_tick - palette_epoch;
+    for (uint8_t i=VGA13_PALETTE_BLACK + 1; i<palette_ramp_lo; ++i)
+    {
+        uint32_t age = palette_tick - VGA13_STAMP[i];
+        if ((VGA13_PIN[i] == 0) && (age >= lru_age))
+        {
+            lru = i;
+            lru_age = age;
+        }
+    }
+    if (lru != VGA13_PALETTE_NOT_FOUND)
+        __vga13_unhash_color(lru);
+    return lru;
 }
 
 /*
@@ -52,82 +307,355 @@ static void __vga13_set_port_color(uint8_t idx, RGB_8 color)
 ** @param color RGB Color to set
 ** @return Look up value in the color palette table. To write to frame buffer
 */
-static uint8_t __vga13_fetch_color(RGB_8 color)
+uint8_t _vga13_fetch_color(RGB_8 color)
 {
+    // repeated requests skip the table entirely
+    if (vga_RGB_8_cmp(color, palette_last))
+    {
+        VGA13_STAMP[palette_last_code] = ++palette_tick;
+        return palette_last_code;
+    }
     // check reserved colors; prevent modification to the palette
-    if (vga_RGB_8_cmp(color, color_palette[VGA13_PALETTE_BLACK]))
+    if (vga_RGB_8_cmp(color, VGA13_COLORS[VGA13_PALETTE_BLACK]))
         return VGA13_PALETTE_BLACK;
-    if (vga_RGB_8_cmp(color, color_palette[VGA13_PALETTE_WHITE]))
+    if (vga_RGB_8_cmp(color, VGA13_COLORS[VGA13_PALETTE_WHITE]))
         return VGA13_PALETTE_WHITE;
-    // perform a search to prevent duplicates
-    uint8_t color_code = VGA13_PALETTE_NOT_FOUND;
-    // For now we will perform a linear search and hope that is fast enough.
-    // Ideally the draw functions should only need to call this once. Commonly
-    // used colors should be "cached" towards the front of the color table;
-    // Only loops until the last color set; prevents wasted search time
-    for (uint8_t i=VGA13_PALETTE_BLACK + 1; i<palette_idx; ++i)
+    // walk the (short) hash chain for this color
+    uint8_t bucket = __vga13_hash_color(color);
+    uint8_t color_code = palette_hash[bucket];
+    while ((color_code != VGA13_PALETTE_NOT_FOUND)
+        && (!vga_RGB_8_cmp(VGA13_COLORS[color_code], color)))
     {
-        if (vga_RGB_8_cmp(color_palette[i], color))
-        {
-            color_code = i;
-            break;
-        }
+        color_code = VGA13_NEXT[color_code];
     }
     // unfound colors are added to the table
     if (color_code == VGA13_PALETTE_NOT_FOUND)
     {
-        // move to the next palette entry, staying within bounds
-        // chances are that all 256 colors will never be fully used in this OS
-        // As a side note, CGA (PCjr) had built-in color palettes
-        __vga13_set_port_color(palette_idx, color);
-        // add color to the table
-        color_code = palette_idx;
-        color_palette[color_code] = color;
-        palette_idx %= (VGA13_PALETTE_SIZE - VGA13_PALETTE_RESERVED);
-        ++palette_idx;
+        color_code = __vga13_alloc_color();
+        if (color_code == VGA13_PALETTE_NOT_FOUND)
+        {
+            // no room left; fall back to the closest color we already have
+            color_code = __vga13_nearest_color(color);
+        }
+        else
+        {
+            __vga13_set_shadow_color(color_code, color);
+            __vga13_update_inv(color_code);
+            VGA13_NEXT[color_code] = palette_hash[bucket];
+            palette_hash[bucket] = color_code;
+        }
     }
+    VGA13_STAMP[color_code] = ++palette_tick;
+    palette_last = color;
+    palette_last_code = color_code;
     return color_code;
 }
 
+/*
+** Pins a palette entry so it is never recycled, even after the screen is
+** cleared, or undoes an earlier pin
+**
+** @param idx Palette index
+** @param pin True to pin, false to undo an earlier pin
+*/
+void _vga13_pin_color(uint8_t idx, bool pin)
+{
+    if (pin)
+        ++VGA13_PIN[idx];
+    else if (VGA13_PIN[idx] > 0)
+        --VGA13_PIN[idx];
+}
+
+/*
+** Looks up the color stored in a palette entry
+**
+** @param idx Palette index
+** @return RGB color of the entry
+*/
+RGB_8 _vga13_palette_color(uint8_t idx)
+{
+    return VGA13_COLORS[idx];
+}
+
+/*
+** Checks if a run of palette entries can be taken over, which is when none of
+** them are pinned or may still be on screen
+**
+** @param idx First palette index
+** @param n Number of entries
+** @return True if all of the entries are free
+*/
+static bool __vga13_ramp_idle(uint8_t idx, uint8_t n)
+{
+    uint32_t min_age = palette_tick - palette_epoch;
+    for (uint8_t i=0; i<n; ++i, ++idx)
+    {
+        if ((VGA13_PIN[idx] > 0)
+            || ((palette_tick - VGA13_STAMP[idx]) < min_age))
+            return false;
+    }
+    return true;
+}
+
+/*
+** Reserves a ramp of palette entries that fade evenly from one color to
+** another. Ramps are carved from the top of the palette, below white, and are
+** never recycled for other colors while they are in use
+**
+** @param c0 Color of the first entry
+** @param c1 Color of the last entry
+** @param n Number of entries
+** @return Palette index of the first entry or VGA_RAMP_NONE
+*/
+uint16_t _vga13_alloc_ramp(RGB_8 c0, RGB_8 c1, uint8_t n)
+{
+    if (n == 0)
+        return VGA_RAMP_NONE;
+    // the same ramp is shared. Otherwise a released ramp of the same size is
+    // taken over before more of the palette is given up
+    VGA13_Ramp* reuse = NULL;
+    VGA13_Ramp* slot = NULL;
+    for (uint8_t i=0; i<VGA13_RAMPS; ++i)
+    {
+        VGA13_Ramp* r = &palette_ramps[i];
+        if ((r->n == n) && vga_RGB_8_cmp(r->c0, c0)
+            && vga_RGB_8_cmp(r->c1, c1))
+        {
+            ++r->cnt;
+            return r->code;
+        }
+        if (r->cnt > 0)
+            continue;
+        if ((r->n == n) && __vga13_ramp_idle(r->code, n))
+            reuse = r;
+        else if ((r->n == 0) && (slot == NULL))
+            slot = r;
+    }
+    if (reuse != NULL)
+        slot = reuse;
+    else if ((slot == NULL)
+        || (n >= (palette_ramp_lo - VGA13_PALETTE_BLACK))
+        || !__vga13_ramp_idle(palette_ramp_lo - n, n))
+        return VGA_RAMP_NONE;
+    else
+    {
+        slot->code = palette_ramp_lo - n;
+        slot->n = n;
+        palette_ramp_lo = slot->code;
+        if (palette_idx > palette_ramp_lo)
+            palette_idx = palette_ramp_lo;
+    }
+    slot->c0 = c0;
+    slot->c1 = c1;
+    slot->cnt = 1;
+    for (uint8_t k=0; k<n; ++k)
+    {
+        uint8_t idx = slot->code + k;
+        // entries that held plain colors have to be forgotten
+        __vga13_unhash_color(idx);
+        __vga13_set_shadow_color(idx, vga_RGB_8_step(c0, c1, k, n));
+        __vga13_update_inv(idx);
+    }
+    // the last color fetched may have been stored in one of the entries
+    palette_last = RGB_8_BLACK;
+    palette_last_code = VGA13_PALETTE_BLACK;
+    return slot->code;
+}
+
+/*
+** Lets go of a ramp from _vga13_alloc_ramp()
+**
+** @param idx Palette index of the first entry
+*/
+void _vga13_free_ramp(uint8_t idx)
+{
+    for (uint8_t i=0; i<VGA13_RAMPS; ++i)
+    {
+        VGA13_Ramp* r = &palette_ramps[i];
+        if ((r->cnt == 0) || (r->code != idx))
+            continue;
+        // the ramp may be on screen until the next clear
+        if (--r->cnt == 0)
+        {
+            ++palette_tick;
+            for (uint8_t k=0; k<r->n; ++k)
+                VGA13_STAMP[idx + k] = palette_tick;
+        }
+        return;
+    }
+}
+
+/*
+** Marks the point where the screen was cleared. Colors that have not been
+** used since then are free to be recycled
+*/
+void _vga13_palette_epoch(void)
+{
+    palette_epoch = palette_tick;
+}
+
 /*
 ** Initializes the color palette
 */
-static void __vga13_init_color()
+void _vga13_init_color(void)
 {
-    // mimmic these changes in our memory mapping
-    color_palette[VGA13_PALETTE_BLACK] = RGB_8_BLACK;
-    color_palette[VGA13_PALETTE_WHITE] = RGB_8_WHITE;
-    // set black and white values
-    __vga13_set_port_color(VGA13_PALETTE_BLACK, RGB_8_BLACK);
-    __vga13_set_port_color(VGA13_PALETTE_WHITE, RGB_8_WHITE);
+    // a saved screen is meaningless with a new palette
+    vga13_saved = false;
+    // set black and white values, in the shadow palette and on the DAC
+    palette_dirty_lo = VGA13_PALETTE_WHITE;
+    palette_dirty_hi = VGA13_PALETTE_BLACK;
+    __vga13_set_shadow_color(VGA13_PALETTE_BLACK, RGB_8_BLACK);
+    __vga13_set_shadow_color(VGA13_PALETTE_WHITE, RGB_8_WHITE);
+    _vga13_flush_palette();
     // valid range: Black + 1 to White - 1
     palette_idx = VGA13_PALETTE_BLACK + 1;
+    palette_ramp_lo = VGA13_PALETTE_WHITE;
+    for (uint8_t i=0; i<VGA13_RAMPS; ++i)
+    {
+        palette_ramps[i].n = 0;
+        palette_ramps[i].cnt = 0;
+    }
+    // forget everything the previous program asked for
+    for (uint8_t i=0; i<VGA13_HASH_SIZE; ++i)
+        palette_hash[i] = VGA13_PALETTE_NOT_FOUND;
+    palette_tick = 0;
+    palette_epoch = 0;
+    for (uint16_t i=0; i<(VGA13_INV_SIZE / 8); ++i)
+        VGA13_INV_VALID[i] = 0;
+    inv_cnt = 0;
+    for (uint16_t i=0; i<VGA13_PALETTE_SIZE; ++i)
+    {
+        VGA13_STAMP[i] = 0;
+        VGA13_PIN[i] = 0;
+    }
+    VGA13_PIN[VGA13_PALETTE_BLACK] = 1;
+    VGA13_PIN[VGA13_PALETTE_WHITE] = 1;
+    palette_last = RGB_8_BLACK;
+    palette_last_code = VGA13_PALETTE_BLACK;
 }
 
 /************************** Draw Functions **************************/
 
 /*
-** Clears the video buffer
+** Copies the whole screen to or from MEM_VGA13_SAVE
+**
+** @param save True to save the screen, false to restore it
 */
-static void __vga13_clrscr(void)
+static void __vga13_screen_copy(bool save)
+{
+    uint32_t* vram = (uint32_t*)VGA13_MEM_BEGIN;
+    uint32_t* copy = MEM_FAR(uint32_t, MEM_VGA13_SAVE);
+    for(uint16_t i=0; i<(VGA13_MEM_SIZE / sizeof(uint32_t)); i++)
+    {
+        if (save)
+            copy[i] = vram[i];
+        else
+            vram[i] = copy[i];
+    }
+}
+
+/*
+** Records that an area of the back buffer was drawn to. Does nothing when
+** drawing straight to the screen
+**
+** @param x0 Left-most x coordinate (inclusive)
+** @param y0 Top-most y coordinate (inclusive)
+** @param x1 Right-most x coordinate (exclusive)
+** @param y1 Bottom-most y coordinate (exclusive)
+*/
+static void __vga13_damage(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
 {
-    uint16_t* addr = (uint16_t*)VGA13_MEM_BEGIN;
-    while(addr < (uint16_t*)VGA13_MEM_END)
+    if (vga13_fb == VGA13_BACK)
+        vga_dirty_add(&vga13_dirty, x0, y0, x1, y1);
+}
+
+/*
+** Copies the areas of the back buffer that were drawn to out to the screen
+*/
+static void __vga13_copy_dirty(void)
+{
+    for (uint8_t i=0; i<vga13_dirty.cnt; ++i)
     {
-        *addr++ = 0;
+        VGA_Rect* r = &vga13_dirty.rect[i];
+        for (uint16_t y=r->y0; y<r->y1; ++y)
+        {
+            uint16_t offset = VGA13_ROW[y] + r->x0;
+            vga_copy_span(VGA13_VRAM + offset, VGA13_BACK + offset,
+                r->x1 - r->x0);
+        }
     }
+    vga13_dirty.cnt = 0;
 }
 
 /*
-** Vertical sync control. Useful for slow electron-gun-based displays
+** Leave Mode 13h. When the mode was entered with VGA_MODE_KEEP_VRAM, the
+** screen is saved so that it can be brought back the same way
 */
-static void __vga13_vsync(void)
+static void __vga13_exit(void)
 {
-    // bit 3 indicates whether or not the display has finished tracing pixels
-    // wait for a previous retrace to end
-    while (_inb(VGA13_VSYNC_PORT) & 0b100) {};
-    // wait for a new retrace to begin
-    while (!(_inb(VGA13_VSYNC_PORT) & 0b100)) {};
+    vga13_saved = vga13_keep;
+    if (!vga13_keep)
+        return;
+    // the screen is only saved from video memory
+    __vga13_copy_dirty();
+    __vga13_screen_copy(true);
+}
+
+/*
+** Clears the video buffer
+*/
+static void __vga13_clrscr(void)
+{
+    // nothing drawn before this point is visible anymore
+    _vga13_palette_epoch();
+    vga_fill_span(vga13_fb, VGA13_MEM_SIZE, VGA13_PALETTE_BLACK);
+    __vga13_damage(0, 0, VGA13_WIDTH, VGA13_HEIGHT);
+}
+
+/*
+** Vertical sync control. Useful for slow electron-gun-based displays. Pending
+** palette changes are flushed while the beam is off
+*/
+void _vga13_vsync(void)
+{
+    vga_wait_retrace();
+    // the beam is off; palette changes can't be seen mid-frame now
+    _vga13_flush_palette();
+}
+
+/*
+** Pushes pending changes out to the display: the shadow palette and, when the
+** back buffer is in use, whatever was drawn to it. The palette goes first;
+** recycled entries are never on the screen, but the new pixels may use them
+*/
+static void __vga13_present(void)
+{
+    _vga13_flush_palette();
+    __vga13_copy_dirty();
+}
+
+/*
+** Switches drawing between video memory and the back buffer
+**
+** @param enable True to draw to the back buffer, false to draw directly to
+**        the screen again
+*/
+static void __vga13_back_buffer(bool enable)
+{
+    if (enable == (vga13_fb == VGA13_BACK))
+        return;
+    if (enable)
+    {
+        // start off with what is on the screen, so nothing needs copying yet
+        vga_copy_span(VGA13_BACK, VGA13_VRAM, VGA13_MEM_SIZE);
+        vga13_dirty.cnt = 0;
+        vga13_fb = VGA13_BACK;
+    }
+    else
+    {
+        __vga13_copy_dirty();
+        vga13_fb = VGA13_VRAM;
+    }
 }
 
 /*
@@ -135,13 +663,14 @@ static void __vga13_vsync(void)
 **
 ** @param x coordinate on the screen
 ** @param y coordinate on the screen
-** @param color Pixel color to write. This is an index into the color palette
+** @param color_code Palette index to write
 */
-static void __vga13_put_pixel(uint16_t x, uint16_t y, RGB_8 color)
+static void __vga13_put_pixel(uint16_t x, uint16_t y, uint8_t color_code)
 {
-    uint8_t color_code = __vga13_fetch_color(color);
-    // calculate the pixel offset and set the pixel accordingly
-    *((uint8_t*)(VGA13_MEM_BEGIN + ((y * VGA13_WIDTH) + x))) = color_code;
+    if (!VGA_CLIP_POINT(x, y))
+        return;
+    __vga13_damage(x, y, x + 1, y + 1);
+    *VGA13_PIXEL(x, y) = color_code;
 }
 
 /*
@@ -149,14 +678,18 @@ static void __vga13_put_pixel(uint16_t x, uint16_t y, RGB_8 color)
 **
 ** @param x coordinate on the screen
 ** @param y coordinate on the screen
-** @param color Pixel color written to the pixel position
+** @param color Pixel color written to the pixel position; black when the
+**        pixel is off the screen
 */
 static void __vga13_get_pixel(uint16_t x, uint16_t y, RGB_8* color)
 {
-    uint8_t color_code =
-        *((uint8_t*)(VGA13_MEM_BEGIN + ((y * VGA13_WIDTH) + x)));
+    if (!VGA_SCREEN_POINT(x, y))
+    {
+        *color = RGB_8_BLACK;
+        return;
+    }
     // look up color in the table and set it
-    *color = color_palette[color_code];
+    *color = _vga13_palette_color(*VGA13_PIXEL(x, y));
 }
 
 /* "Fast" (i.e. lazy) drawing methods */
@@ -168,45 +701,20 @@ static void __vga13_get_pixel(uint16_t x, uint16_t y, RGB_8* color)
 ** @param ury Upper-right y coordinate on the screen
 ** @param llx Lower-left x coordinate on the screen
 ** @param lly Lower-left y coordinate on the screen
-** @param color Pixel color to write. This is an index into the color palette
+** @param color_code Palette index to write
 */
 static void __vga13_draw_rect(uint16_t urx, uint16_t ury, uint16_t llx,
-    uint16_t lly, RGB_8 color)
-{
-    uint8_t color_code = __vga13_fetch_color(color);
-    // we actually start drawing on the upper left pixel, so calculate the
-    // address at that position first
-    uint16_t* addr = (uint16_t*)(VGA13_MEM_BEGIN + ((ury * VGA13_WIDTH) + llx));
-    // iterate in a smart fashion, reducing memory access
-
-    // do a little preprocessing: how many times we can do chunk copies per
-    // scanline. this reduces the number of memory writes we need to do as
-    // these addresses are right next to each other
-    uint8_t div = (urx - llx) / sizeof(uint16_t);
-    uint8_t rem = (urx - llx) % sizeof(uint16_t);
-    uint16_t packed_color = color_code;
-    packed_color <<= 8; packed_color += color_code;
-
-    // difference in address between end of current and start of next scanline
-    uint16_t addr_diff = (VGA13_WIDTH - urx) + llx;
-
-    // iterate over all scanlines
-    for (uint16_t yi=0; yi<(lly - ury); yi++)
+    uint16_t lly, uint8_t color_code)
+{
+    if (!vga_clip_rect(&llx, &ury, &urx, &lly))
+        return;
+    __vga13_damage(llx, ury, urx, lly);
+    uint8_t* addr = VGA13_PIXEL(llx, ury);
+    // one span per scanline
+    for (uint16_t y=ury; y<lly; ++y)
     {
-        // draw the rectangles
-        // iterate down the scanline
-        for (uint16_t xi=0; xi<div; xi++)
-        {
-            *addr++ = packed_color;
-        }
-        // finish the remaining amount by writing bytes out
-        for (uint16_t xi=0; xi<rem; xi++)
-        {
-            *((uint8_t*)addr) = color_code;
-            addr++;
-        }
-        // advance the address to the start of the next scanline pixel to draw
-        addr += (addr_diff / sizeof(uint16_t));
+        vga_fill_span(addr, urx - llx, color_code);
+        addr += VGA13_WIDTH;
     }
 }
 
@@ -217,12 +725,212 @@ static void __vga13_draw_rect(uint16_t urx, uint16_t ury, uint16_t llx,
 ** @param uly Upper-left y coordinate on the screen
 ** @param w Width of the rectangle
 ** @param h Height of the rectangle
-** @param color Pixel color to write. This is an index into the color palette
+** @param color_code Palette index to write
 */
 static void __vga13_draw_rect_wh(uint16_t ulx, uint16_t uly, uint16_t w,
-    uint16_t h, RGB_8 color)
+    uint16_t h, uint8_t color_code)
+{
+    __vga13_draw_rect(ulx + w, uly, ulx, uly + h, color_code);
+}
+
+/*
+** Draws a horizontal run of pixels
+**
+** @param x Left-most x coordinate on the screen
+** @param y coordinate on the screen
+** @param w Number of pixels to draw
+** @param color_code Palette index to write
+*/
+static void __vga13_hspan(uint16_t x, uint16_t y, uint16_t w,
+    uint8_t color_code)
+{
+    uint16_t x1 = x + w, y1 = y + 1;
+    if (!vga_clip_rect(&x, &y, &x1, &y1))
+        return;
+    __vga13_damage(x, y, x1, y1);
+    vga_fill_span(VGA13_PIXEL(x, y), x1 - x, color_code);
+}
+
+/*
+** Draws a vertical run of pixels
+**
+** @param x coordinate on the screen
+** @param y Top-most y coordinate on the screen
+** @param h Number of pixels to draw
+** @param color_code Palette index to write
+*/
+static void __vga13_vspan(uint16_t x, uint16_t y, uint16_t h,
+    uint8_t color_code)
+{
+    uint16_t x1 = x + 1, y1 = y + h;
+    if (!vga_clip_rect(&x, &y, &x1, &y1))
+        return;
+    __vga13_damage(x, y, x1, y1);
+    uint8_t* addr = VGA13_PIXEL(x, y);
+    for (h = y1 - y; h; --h)
+    {
+        *addr = color_code;
+        addr += VGA13_WIDTH;
+    }
+}
+
+/*
+** Draws a row of pixels given as indices into a caller-supplied palette. Runs
+** of equal indices are filled as spans
+**
+** @param x Left-most x coordinate on the screen
+** @param y coordinate on the screen
+** @param w Number of pixels in the row
+** @param idx Palette index of each pixel
+** @param pal Palette the indices refer to, as palette indices
+** @param key Index that is left transparent, VGA_BLIT_OPAQUE for none
+*/
+static void __vga13_blit_row(uint16_t x, uint16_t y, uint16_t w,
+    const uint8_t* idx, const uint8_t* pal, uint16_t key)
+{
+    uint16_t x0 = x, y0 = y, x1 = x + w, y1 = y + 1;
+    if (!vga_clip_rect(&x0, &y0, &x1, &y1))
+        return;
+    __vga13_damage(x0, y0, x1, y1);
+    // indices stay relative to x; only the visible ones are walked. x may be
+    // left of the screen, so the address is worked out from x0
+    uint16_t i = x0 - x;
+    uint8_t* addr = VGA13_PIXEL(x0, y) - i;
+    w = x1 - x;
+    while (i < w)
+    {
+        uint16_t run = i;
+        uint8_t code = idx[i];
+        while ((i < w) && (idx[i] == code))
+            ++i;
+        if (code != key)
+            vga_fill_span(addr + run, i - run, pal[code]);
+    }
+}
+
+/*
+** Draws a 1 bit-per-pixel mask; set bits are drawn in one color and clear
+** bits in another, or left alone. The most significant bit is the left-most
+** pixel. When the visible part starts and ends on a multiple of 4 columns,
+** each 4 mask bits are expanded through a table and written as one 32-bit
+** store
+**
+** @param x Left-most x coordinate on the screen
+** @param y Top-most y coordinate on the screen
+** @param w Width of the mask, in pixels
+** @param h Height of the mask, in pixels
+** @param bits Mask rows
+** @param stride Number of bytes between the start of each mask row
+** @param color_code Palette index to write for set bits
+** @param bg_code Palette index to write for clear bits, VGA_BLIT_CLEAR to
+**        leave them alone
+*/
+static void __vga13_blit_mask(uint16_t x, uint16_t y, uint16_t w,
+    uint16_t h, const uint8_t* bits, uint16_t stride, uint8_t color_code,
+    uint16_t bg_code)
 {
-    __vga13_draw_rect(ulx + w, uly, ulx, uly + h, color);
+    uint16_t x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+    if (!vga_clip_rect(&x0, &y0, &x1, &y1))
+        return;
+    __vga13_damage(x0, y0, x1, y1);
+    // mask columns stay relative to x; only the visible ones are walked
+    uint16_t c0 = x0 - x, c1 = x1 - x;
+    uint8_t* addr = VGA13_PIXEL(x0, y0) - c0;
+    bits += (y0 - y) * stride;
+    h = y1 - y0;
+    if (((c0 | c1) & 3) == 0)
+    {
+        uint32_t fg = color_code * 0x01010101;
+        uint32_t bg = (uint8_t)bg_code * 0x01010101;
+        for (; h; --h)
+        {
+            for (uint16_t col=c0; col<c1; col+=4)
+            {
+                // the left nibble of each byte comes first
+                uint32_t mask =
+                    vga13_nibble[(bits[col >> 3] >> (~col & 4)) & 0xF];
+                uint32_t* dst = (uint32_t*)(addr + col);
+                if (bg_code != VGA_BLIT_CLEAR)
+                    *dst = (fg & mask) | (bg & ~mask);
+                else if (mask != 0)
+                    *dst = (*dst & ~mask) | (fg & mask);
+            }
+            bits += stride;
+            addr += VGA13_WIDTH;
+        }
+        return;
+    }
+    for (; h; --h)
+    {
+        if (bg_code != VGA_BLIT_CLEAR)
+            vga_fill_span(addr + c0, c1 - c0, bg_code);
+        uint16_t col = c0;
+        while (col < c1)
+        {
+            uint8_t byte = bits[col >> 3] << (col & 7);
+            // most glyph bytes are blank
+            if (byte == 0)
+            {
+                col = (col | 7) + 1;
+                continue;
+            }
+            for (; byte && (col < c1); byte <<= 1, ++col)
+            {
+                if (byte & 0x80)
+                    addr[col] = color_code;
+            }
+            // any bits left were clear; skip to the next byte
+            if (col & 7)
+                col = (col | 7) + 1;
+        }
+        bits += stride;
+        addr += VGA13_WIDTH;
+    }
+}
+
+/*
+** Copies one area of the screen to another. The areas may overlap: rows are
+** copied bottom-up when moving down and a row is copied right-to-left when it
+** moves right onto itself, so nothing is written over before it is read
+**
+** @param sx Upper-left x coordinate to copy from
+** @param sy Upper-left y coordinate to copy from
+** @param dx Upper-left x coordinate to copy to
+** @param dy Upper-left y coordinate to copy to
+** @param w Width of the area
+** @param h Height of the area
+*/
+static void __vga13_copy_rect(uint16_t sx, uint16_t sy, uint16_t dx,
+    uint16_t dy, uint16_t w, uint16_t h)
+{
+    if (!vga_clip_copy(&sx, &sy, &dx, &dy, &w, &h))
+        return;
+    __vga13_damage(dx, dy, dx + w, dy + h);
+    int16_t step = VGA13_WIDTH;
+    if (dy > sy)
+    {
+        sy += h - 1;
+        dy += h - 1;
+        step = -VGA13_WIDTH;
+    }
+    uint8_t* src = VGA13_PIXEL(sx, sy);
+    uint8_t* dst = VGA13_PIXEL(dx, dy);
+    bool back = (dy == sy) && (dx > sx);
+    for (; h; --h)
+    {
+        if (back)
+        {
+            for (uint16_t i=w; i; --i)
+                dst[i - 1] = src[i - 1];
+        }
+        else
+        {
+            for (uint16_t i=0; i<w; ++i)
+                dst[i] = src[i];
+        }
+        src += step;
+        dst += step;
+    }
 }
 
 /************************** GL-Visible Functions **************************/
@@ -243,19 +951,45 @@ void _vga13_enter(VGA_Driver* driver)
     driver->vga_mode = VGA_MODE_13;
     // set all the functions here
     driver->vga_enter = &_vga13_enter;
+    driver->vga_exit = &__vga13_exit;
     driver->vga_clrscr = &__vga13_clrscr;
-    driver->vga_vsync = &__vga13_vsync;
+    driver->vga_vsync = &_vga13_vsync;
+    driver->vga_present = &__vga13_present;
+    driver->vga_fetch_color = &_vga13_fetch_color;
+    driver->vga_pin_color = &_vga13_pin_color;
+    driver->vga_alloc_ramp = &_vga13_alloc_ramp;
+    driver->vga_free_ramp = &_vga13_free_ramp;
     driver->vga_put_pixel = &__vga13_put_pixel;
     driver->vga_get_pixel = &__vga13_get_pixel;
     driver->vga_draw_rect = &__vga13_draw_rect;
     driver->vga_draw_rect_wh = &__vga13_draw_rect_wh;
+    driver->vga_hspan = &__vga13_hspan;
+    driver->vga_vspan = &__vga13_vspan;
+    driver->vga_blit_row = &__vga13_blit_row;
+    driver->vga_blit_mask = &__vga13_blit_mask;
+    driver->vga_copy_rect = &__vga13_copy_rect;
+    driver->vga_back_buffer = &__vga13_back_buffer;
+    vga13_fb = VGA13_VRAM;
+    vga13_dirty.cnt = 0;
+    for (uint16_t y=0; y<VGA13_HEIGHT; ++y)
+        VGA13_ROW[y] = y * VGA13_WIDTH;
 
-    // BIOS interrupt appears to clear memory on reset
-    __asm__ __volatile__("movb $0x13, %al\n");
-    __asm__ __volatile__("movb $0x00, %ah\n");
-    __asm__ __volatile__("int  $0x10\n");
+    // program the registers directly; much faster than the BIOS, which also
+    // insists on clearing video memory
+    vga_write_regs(vga13_regs);
+    vga13_keep = driver->vga_flags & VGA_MODE_KEEP_VRAM;
+    if (vga13_keep && vga13_saved)
+    {
+        // bring back the screen and every palette entry it may use
+        __vga13_screen_copy(false);
+        palette_dirty_lo = VGA13_PALETTE_BLACK;
+        palette_dirty_hi = VGA13_PALETTE_WHITE;
+        _vga13_flush_palette();
+        return;
+    }
+    __vga13_clrscr();
     // prep the color palette system. This should be a sufficient reset so that
     // a previous program's color requests don't interfere with the current's
-    __vga13_init_color();
+    _vga13_init_color();
 }
 
@@ -33,16 +33,38 @@
 #define VGA13_PALETTE_RESERVED  2
 // Error codes mapped to reserved colors, since we will never overwrite them
 #define VGA13_PALETTE_NOT_FOUND VGA13_PALETTE_BLACK
+// number of buckets in the RGB -> palette index hash (must be a power of 2)
+#define VGA13_HASH_SIZE         64
+// Inverse color map used once the palette is exhausted: RGB is quantized to
+// this many bits per channel and maps to the nearest palette entry
+#define VGA13_INV_BITS          4
+#define VGA13_INV_SIZE          (1 << (3 * VGA13_INV_BITS))
+// most color ramps that can be reserved at once
+#define VGA13_RAMPS             4
 // Port addresses for palette control; these are 
 #define VGA13_PALETTE_PORT_IDX  0x03C8
 #define VGA13_PALETTE_PORT_CLR  0x03C9
 // Port for retrace information, used for V-Sync
-#define VGA13_VSYNC_PORT        0x3DA
+#define VGA13_VSYNC_PORT        VGA_STATUS_PORT
 
 /** Globals    **/
 
 /** Structures **/
 
+// color ramp, see _vga13_alloc_ramp()
+typedef struct VGA13_Ramp
+{
+    // end colors and the first palette index of the ramp
+    RGB_8 c0;
+    RGB_8 c1;
+    uint8_t code;
+    // number of entries; 0 marks an unused slot
+    uint8_t n;
+    // number of users. Released ramps keep their entries, so the same ramp can
+    // be handed out again
+    uint8_t cnt;
+} VGA13_Ramp;
+
 /** Functions  **/
 
 /*
@@ -52,4 +74,78 @@
 */
 void _vga13_enter(VGA_Driver* driver);
 
+/*
+** The functions below manage the 256 color palette. They are shared with the
+** other 256 color drivers, which use the same DAC
+*/
+
+/*
+** Fetchs a color in the VGA13 palette. If a match is not found, the color
+** is added to the table for future use
+**
+** @param color RGB Color to set
+** @return Look up value in the color palette table. To write to frame buffer
+*/
+uint8_t _vga13_fetch_color(RGB_8 color);
+
+/*
+** Pins a palette entry so it is never recycled, even after the screen is
+** cleared, or undoes an earlier pin
+**
+** @param idx Palette index
+** @param pin True to pin, false to undo an earlier pin
+*/
+void _vga13_pin_color(uint8_t idx, bool pin);
+
+/*
+** Looks up the color stored in a palette entry
+**
+** @param idx Palette index
+** @return RGB color of the entry
+*/
+RGB_8 _vga13_palette_color(uint8_t idx);
+
+/*
+** Reserves a ramp of palette entries that fade evenly from one color to
+** another. Ramps are carved from the top of the palette, below white, and are
+** never recycled for other colors while they are in use
+**
+** @param c0 Color of the first entry
+** @param c1 Color of the last entry
+** @param n Number of entries
+** @return Palette index of the first entry or VGA_RAMP_NONE
+*/
+uint16_t _vga13_alloc_ramp(RGB_8 c0, RGB_8 c1, uint8_t n);
+
+/*
+** Lets go of a ramp from _vga13_alloc_ramp()
+**
+** @param idx Palette index of the first entry
+*/
+void _vga13_free_ramp(uint8_t idx);
+
+/*
+** Marks the point where the screen was cleared. Colors that have not been
+** used since then are free to be recycled
+*/
+void _vga13_palette_epoch(void);
+
+/*
+** Initializes the color palette
+*/
+void _vga13_init_color(void);
+
+/*
+** Uploads the dirty range of the shadow palette to the VGA controller using
+** Port I/O. The index is only written once; the DAC auto-increments after
+** every third color byte
+*/
+void _vga13_flush_palette(void);
+
+/*
+** Vertical sync control. Useful for slow electron-gun-based displays. Pending
+** palette changes are flushed while the beam is off
+*/
+void _vga13_vsync(void);
+
 #endif
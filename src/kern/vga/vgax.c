@@ -0,0 +1,287 @@
+/*
+** File:    vgax.c
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Driver for VGA's "Mode X" graphics mode
+**              Mode X is Mode 13h with chain-4 turned off, exposing all four
+**              memory planes. This gives a 320x240 screen with enough video
+**              memory left over to draw into an off-screen page and flip it
+**              onto the display
+*/
+
+/** Headers    **/
+#include "../gcc16.h"
+#include "../asm_lib.h"
+#include "vgax.h"
+// Mode X shares the 256 color palette manager with Mode 13h
+#include "vga13.h"
+
+/** Macros     **/
+// GC mode register values: 256 color shift mode, with write mode 0 (normal
+// CPU writes) or write mode 1 (write the latches, for VRAM to VRAM copies)
+#define VGAX_GC_MODE_WRITE  0x40
+#define VGAX_GC_MODE_LATCH  0x41
+
+/** Globals    **/
+// CRTC register settings that turn 320x200 into 320x240 with square pixels
+static const uint16_t vgax_crtc[] =
+{
+    0x0D06,     // vertical total
+    0x3E07,     // overflow
+    0x4109,     // cell height (2 scanlines per row)
+    0xEA10,     // vertical sync start
+    0xAC11,     // vertical sync end (and protect bits)
+    0xDF12,     // vertical displayed
+    0x0014,     // turn off double word addressing
+    0xE715,     // vertical blank start
+    0x0616,     // vertical blank end
+    0xE317,     // turn on byte mode addressing
+};
+// offsets of the page being drawn to and the page on the display
+static uint16_t vgax_draw;
+static uint16_t vgax_show;
+// set after a flip; the draw page is behind the display until it is either
+// cleared or caught up with a copy of the page on screen
+static bool vgax_stale;
+
+/************************** Internal Functions **************************/
+
+/*
+** Brings the draw page up to date with the page on screen. The copy goes
+** through the VGA latches, so each byte moves 4 pixels at once
+*/
+static void __vgax_sync(void)
+{
+    if (!vgax_stale)
+        return;
+    vgax_stale = false;
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MAP_MASK, 0x0F);
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_MODE, VGAX_GC_MODE_LATCH);
+    volatile uint8_t* src = (uint8_t*)(VGAX_MEM_BEGIN + vgax_show);
+    volatile uint8_t* dst = (uint8_t*)(VGAX_MEM_BEGIN + vgax_draw);
+    for(uint16_t i=0; i<VGAX_PAGE_SIZE; i++)
+    {
+        // the read fills the latches; the written value is ignored
+        dst[i] = src[i];
+    }
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_MODE, VGAX_GC_MODE_WRITE);
+}
+
+/*
+** Fills a block of byte columns on the draw page. Every byte written sets
+** one pixel in each plane enabled by the mask
+**
+** @param col First byte column
+** @param y First scanline
+** @param w Width of the block, in byte columns
+** @param h Height of the block, in scanlines
+** @param mask Planes to write to
+** @param color_code Palette index to fill with
+*/
+static void __vgax_fill(uint16_t col, uint16_t y, uint16_t w, uint16_t h,
+    uint8_t mask, uint8_t color_code)
+{
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MAP_MASK, mask);
+    uint8_t* row = (uint8_t*)(VGAX_MEM_BEGIN + vgax_draw
+        + (y * VGAX_ROW_SIZE) + col);
+    for(; h>0; h--)
+    {
+        vga_fill_span(row, w, color_code);
+        row += VGAX_ROW_SIZE;
+    }
+}
+
+/************************** Draw Functions **************************/
+
+/*
+** Clears the video buffer. Only the page being drawn to is cleared
+*/
+static void __vgax_clrscr(void)
+{
+    // nothing drawn before this point is visible after the next flip
+    _vga13_palette_epoch();
+    // the old contents are being thrown out, so don't bother copying them
+    vgax_stale = false;
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MAP_MASK, 0x0F);
+    uint16_t* addr = (uint16_t*)(VGAX_MEM_BEGIN + vgax_draw);
+    for(uint16_t i=0; i<(VGAX_PAGE_SIZE / sizeof(uint16_t)); i++)
+    {
+        *addr++ = 0;
+    }
+}
+
+/*
+** Flips the finished draw page onto the display. The new start address is
+** latched by the CRTC at the start of the retrace, so waiting for the retrace
+** guarantees the old page is off the screen before it gets drawn over
+*/
+static void __vgax_present(void)
+{
+    // write the start address during the display period so that both halves
+    // get latched together
+    while (_inb(VGA_STATUS_PORT) & 0b1) {};
+    vga_write_reg(VGA_CRTC_IDX_PORT, VGA_CRTC_START_HI, vgax_draw >> 8);
+    vga_write_reg(VGA_CRTC_IDX_PORT, VGA_CRTC_START_LO, vgax_draw & 0xFF);
+    _vga13_vsync();
+    // draw to the next page in line
+    vgax_show = vgax_draw;
+    vgax_draw += VGAX_PAGE_SIZE;
+    if (vgax_draw >= (VGAX_PAGES * VGAX_PAGE_SIZE))
+        vgax_draw = 0;
+    vgax_stale = true;
+}
+
+/*
+** Write a pixel out to the frame buffer. This represents a single pixel
+**
+** @param x coordinate on the screen
+** @param y coordinate on the screen
+** @param color_code Color code to write
+*/
+static void __vgax_put_pixel(uint16_t x, uint16_t y, uint8_t color_code)
+{
+    if (!VGA_CLIP_POINT(x, y))
+        return;
+    __vgax_sync();
+    // the low 2 bits of x pick the plane
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MAP_MASK, 1 << (x & 3));
+    *((uint8_t*)(VGAX_MEM_BEGIN + vgax_draw + (y * VGAX_ROW_SIZE) + (x >> 2)))
+        = color_code;
+}
+
+/*
+** Read a pixel out of the frame buffer. This represents a single pixel
+**
+** @param x coordinate on the screen
+** @param y coordinate on the screen
+** @param color Pixel color written to the pixel position; black when the
+**        pixel is off the screen
+*/
+static void __vgax_get_pixel(uint16_t x, uint16_t y, RGB_8* color)
+{
+    if (!VGA_SCREEN_POINT(x, y))
+    {
+        *color = (RGB_8){0, 0, 0};
+        return;
+    }
+    __vgax_sync();
+    vga_write_reg(VGA_GC_IDX_PORT, VGA_GC_READ_MAP, x & 3);
+    uint8_t color_code = *((uint8_t*)(VGAX_MEM_BEGIN + vgax_draw
+        + (y * VGAX_ROW_SIZE) + (x >> 2)));
+    *color = _vga13_palette_color(color_code);
+}
+
+/*
+** Draws a simple rectangle. The inner byte columns are written to all four
+** planes at once; only the partial columns on either end need their own mask
+**
+** @param urx Upper-right x coordinate on the screen
+** @param ury Upper-right y coordinate on the screen
+** @param llx Lower-left x coordinate on the screen
+** @param lly Lower-left y coordinate on the screen
+** @param color_code Color code to write
+*/
+static void __vgax_draw_rect(uint16_t urx, uint16_t ury, uint16_t llx,
+    uint16_t lly, uint8_t color_code)
+{
+    if (!vga_clip_rect(&llx, &ury, &urx, &lly))
+        return;
+    __vgax_sync();
+    uint16_t h = lly - ury;
+    // byte columns holding the first and last pixels
+    uint16_t col0 = llx >> 2;
+    uint16_t col1 = (urx - 1) >> 2;
+    uint8_t l_mask = (0x0F << (llx & 3)) & 0x0F;
+    uint8_t r_mask = 0x0F >> (3 - ((urx - 1) & 3));
+    if (col0 == col1)
+    {
+        __vgax_fill(col0, ury, 1, h, l_mask & r_mask, color_code);
+        return;
+    }
+    __vgax_fill(col0, ury, 1, h, l_mask, color_code);
+    if ((col1 - col0) > 1)
+        __vgax_fill(col0 + 1, ury, col1 - col0 - 1, h, 0x0F, color_code);
+    __vgax_fill(col1, ury, 1, h, r_mask, color_code);
+}
+
+/*
+** Draws a simple rectangle, using alternative parameter listings
+**
+** @param ulx Upper-left x coordinate on the screen
+** @param uly Upper-left y coordinate on the screen
+** @param w Width of the rectangle
+** @param h Height of the rectangle
+** @param color_code Color code to write
+*/
+static void __vgax_draw_rect_wh(uint16_t ulx, uint16_t uly, uint16_t w,
+    uint16_t h, uint8_t color_code)
+{
+    __vgax_draw_rect(ulx + w, uly, ulx, uly + h, color_code);
+}
+
+/************************** GL-Visible Functions **************************/
+
+/*
+** Start VGA's Mode X
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _vgax_enter(VGA_Driver* driver)
+{
+    driver->screen_w = VGAX_WIDTH;
+    driver->screen_h = VGAX_HEIGHT;
+    driver->frame_buff = (uint16_t*)VGAX_MEM_BEGIN;
+    driver->vga_mode = VGA_MODE_X;
+    // set all the functions here
+    driver->vga_enter = &_vgax_enter;
+    driver->vga_exit = NULL;
+    driver->vga_clrscr = &__vgax_clrscr;
+    driver->vga_vsync = &_vga13_vsync;
+    driver->vga_present = &__vgax_present;
+    driver->vga_fetch_color = &_vga13_fetch_color;
+    driver->vga_pin_color = &_vga13_pin_color;
+    driver->vga_alloc_ramp = &_vga13_alloc_ramp;
+    driver->vga_free_ramp = &_vga13_free_ramp;
+    driver->vga_put_pixel = &__vgax_put_pixel;
+    driver->vga_get_pixel = &__vgax_get_pixel;
+    driver->vga_draw_rect = &__vgax_draw_rect;
+    driver->vga_draw_rect_wh = &__vgax_draw_rect_wh;
+    // spans, blits and copies are built on the functions above
+    vga_generic_ops(driver);
+    driver->vga_back_buffer = NULL;
+
+    // Mode X is built on top of Mode 13h
+    __asm__ __volatile__("movb $0x13, %al\n");
+    __asm__ __volatile__("movb $0x00, %ah\n");
+    __asm__ __volatile__("int  $0x10\n");
+    // turn off chain-4, so the planes are addressed individually
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MEM_MODE, 0x06);
+    // switch to the 25MHz clock and 480 line sync polarity, holding the
+    // sequencer in reset while the clock changes
+    vga_write_reg(VGA_SEQ_IDX_PORT, 0x00, 0x01);
+    _outb(VGA_MISC_OUT_PORT, 0xE3);
+    vga_write_reg(VGA_SEQ_IDX_PORT, 0x00, 0x03);
+    // unlock CRTC registers 0-7, then reprogram the vertical timing
+    vga_write_reg(VGA_CRTC_IDX_PORT, 0x11,
+        vga_read_reg(VGA_CRTC_IDX_PORT, 0x11) & 0x7F);
+    for(uint8_t i=0; i<(sizeof(vgax_crtc) / sizeof(vgax_crtc[0])); i++)
+    {
+        vga_write_reg(VGA_CRTC_IDX_PORT, vgax_crtc[i] & 0xFF,
+            vgax_crtc[i] >> 8);
+    }
+    // display the first page and draw to the second
+    vgax_show = 0;
+    vgax_draw = VGAX_PAGE_SIZE;
+    vgax_stale = false;
+    vga_write_reg(VGA_CRTC_IDX_PORT, VGA_CRTC_START_HI, 0);
+    vga_write_reg(VGA_CRTC_IDX_PORT, VGA_CRTC_START_LO, 0);
+    // the BIOS only cleared the memory Mode 13h could see
+    vga_write_reg(VGA_SEQ_IDX_PORT, VGA_SEQ_MAP_MASK, 0x0F);
+    uint16_t* addr = (uint16_t*)VGAX_MEM_BEGIN;
+    for(uint16_t i=0; i<((VGAX_PAGES * VGAX_PAGE_SIZE) / 2); i++)
+    {
+        *addr++ = 0;
+    }
+    _vga13_init_color();
+}
@@ -0,0 +1,41 @@
+/*
+** File:    vgax.h
+**
+** Author:  Schuyler Martin <sam8050@rit.edu>
+**
+** Description: Driver for VGA's "Mode X" graphics mode
+**              Mode X is Mode 13h with chain-4 turned off, exposing all four
+**              memory planes. This gives a 320x240 screen with enough video
+**              memory left over to draw into an off-screen page and flip it
+**              onto the display
+*/
+#ifndef _VGAX_H_
+#define _VGAX_H_
+
+/** Headers    **/
+#include "../gcc16.h"
+#include "../types.h"
+// standard header for VGA drivers
+#include "vga.h"
+
+/** Macros     **/
+// Graphics mode screen dimensions
+#define VGAX_WIDTH      320
+#define VGAX_HEIGHT     240
+// each byte address covers 4 pixels, one in each plane
+#define VGAX_ROW_SIZE   (VGAX_WIDTH / 4)
+#define VGAX_PAGE_SIZE  (VGAX_ROW_SIZE * VGAX_HEIGHT)
+// number of video pages to flip between (64kB per plane fits 3)
+#define VGAX_PAGES      2
+#define VGAX_MEM_BEGIN  0xA0000
+
+/** Functions  **/
+
+/*
+** Start VGA's Mode X
+**
+** @param driver Standard driver spec for a driver to setup
+*/
+void _vgax_enter(VGA_Driver* driver);
+
+#endif
@@ -85,18 +85,21 @@ static void __hsc_tp_draw_board(void)
         {180, 180, 180}, {117, 117, 117},
         { 53,  53,  53}, {  0,   0,   0},
     };
-    // iterator
-    RGB_8* color = colors;
-
-    // iterate over all the colors
+    // lay out a square for each color, then draw them all at once
+    GL_Rect board[MACBETH_ROWS * MACBETH_COLS];
+    GL_Rect* rect = board;
     for (uint8_t row=0; row<MACBETH_ROWS; ++row)
     {
         for (uint8_t col=0; col<MACBETH_COLS; ++col)
         {
-            gl_draw_rect_wh(PT2((w*col) + x_offset, (h*row) + y_offset),
-                w, h, *color++);
+            rect->ul = PT2((w*col) + x_offset, (h*row) + y_offset);
+            rect->w = w;
+            rect->h = h;
+            rect->color = colors[(row * MACBETH_COLS) + col];
+            ++rect;
         }
     }
+    gl_draw_rects(board, MACBETH_ROWS * MACBETH_COLS);
 }
 
 /*
@@ -104,27 +107,31 @@ static void __hsc_tp_draw_board(void)
 */
 static void __hsc_tp_draw_HSC(void)
 {
-    // white border
-    gl_draw_rect_wh(PT2(50, 30), 220, 140, RGB_WHITE);
-    // H
-    gl_draw_rect_wh(PT2( 65, 40), 20, 120, RGB_HSC);
-    gl_draw_rect_wh(PT2( 85, 95), 20,  10, RGB_HSC);
-    gl_draw_rect_wh(PT2(105, 40), 20, 120, RGB_HSC);
-    // S
-    gl_draw_rect_wh(PT2(135,  43), 20, 60, RGB_HSC);
-    gl_draw_rect_wh(PT2(155,  40), 40, 25, RGB_HSC);
-    gl_draw_rect_wh(PT2(155,  90), 20, 20, RGB_HSC);
-    gl_draw_rect_wh(PT2(175,  95), 20, 63, RGB_HSC);
-    gl_draw_rect_wh(PT2(135, 135), 40, 25, RGB_HSC);
-    // C
-    gl_draw_rect_wh(PT2(205,  43), 20, 114, RGB_HSC);
-    gl_draw_rect_wh(PT2(225,  40), 40,  20, RGB_HSC);
-    gl_draw_rect_wh(PT2(225, 140), 40,  20, RGB_HSC);
-    // I'm lazy at this point...screw the z axis.
-    // white stripes on the logo
-    gl_draw_rect_wh(PT2(50, 135), 220, 3, RGB_WHITE);
-    gl_draw_rect_wh(PT2(50, 143), 220, 3, RGB_WHITE);
-    gl_draw_rect_wh(PT2(50, 150), 220, 3, RGB_WHITE);
+    GL_Rect logo[] =
+    {
+        // white border
+        {{ 50,  30}, 220, 140, RGB_WHITE},
+        // H
+        {{ 65,  40},  20, 120, RGB_HSC},
+        {{ 85,  95},  20,  10, RGB_HSC},
+        {{105,  40},  20, 120, RGB_HSC},
+        // S
+        {{135,  43},  20,  60, RGB_HSC},
+        {{155,  40},  40,  25, RGB_HSC},
+        {{155,  90},  20,  20, RGB_HSC},
+        {{175,  95},  20,  63, RGB_HSC},
+        {{135, 135},  40,  25, RGB_HSC},
+        // C
+        {{205,  43},  20, 114, RGB_HSC},
+        {{225,  40},  40,  20, RGB_HSC},
+        {{225, 140},  40,  20, RGB_HSC},
+        // I'm lazy at this point...screw the z axis.
+        // white stripes on the logo
+        {{ 50, 135}, 220,   3, RGB_WHITE},
+        {{ 50, 143}, 220,   3, RGB_WHITE},
+        {{ 50, 150}, 220,   3, RGB_WHITE},
+    };
+    gl_draw_rects(logo, sizeof(logo) / sizeof(logo[0]));
     // draw a string
     gl_draw_str(PT2(20, 180), RGB(255, 100, 0), RGB_HSC, HSC_NAME);
 }
@@ -162,10 +169,30 @@ uint8_t hsc_tp_main(uint8_t argc, char* argv[])
         return ERR_PROG_USAGE;
     // enter graphics mode, based on user input
     uint16_t vga_mode = 0;
-    if (kio_strcmp(argv[1], "13"))
+    if (kio_strcmp(argv[1], "4"))
+    {
+        vga_mode = VGA_MODE_CGA4;
+    }
+    else if (kio_strcmp(argv[1], "5"))
+    {
+        vga_mode = VGA_MODE_CGA5;
+    }
+    else if (kio_strcmp(argv[1], "12"))
+    {
+        vga_mode = VGA_MODE_12;
+    }
+    else if (kio_strcmp(argv[1], "13"))
     {
         vga_mode = VGA_MODE_13;
     }
+    else if (kio_strcmp(argv[1], "x"))
+    {
+        vga_mode = VGA_MODE_X;
+    }
+    else if (kio_strcmp(argv[1], "vbe"))
+    {
+        vga_mode = VGA_MODE_VBE;
+    }
     else
         return ERR_PROG_BAD_ARGS;
     gl_enter(vga_mode);
@@ -211,6 +238,7 @@ uint8_t hsc_tp_main(uint8_t argc, char* argv[])
         return ERR_PROG_BAD_ARGS;
     }
 
+    gl_present();
     // block for user input
     kio_wait_key('q');
 
@@ -279,6 +279,7 @@ void seesh_splash(void)
     str_ul.x = (gl_getw() - str_bb.x) / 2;
     str_ul.y = gl_geth() - (str_bb.y + (str_bb.y / 2));
     gl_draw_str_scale(str_ul, RGB_HSC, RGB_HSC, "SeeGOL", 2, gl_getw());
+    gl_present();
     // "It really gets [the crowd excited] when they see this ramp just slowly 
     // extending down." - Rick Sanchez
     clk_busy_wait(4);
@@ -297,8 +298,9 @@ uint8_t seesh_gui_main(void)
 
     while(true)
     {
-        // default to VGA13
-        pane_enter(VGA_MODE_13);
+        // default to VGA13. The menu is brought back as it was left when a
+        // program returns
+        pane_enter(VGA_MODE_13 | VGA_MODE_KEEP_VRAM);
         // user picks from the list of programs
         uint8_t pid = pane_draw_prompt("SeeGOL Programs", GUI_PROG_COUNT,
             gui_prog_disp);
@@ -73,6 +73,7 @@ uint8_t slideshow_main(uint8_t argc, char* argv[])
         }
         // draw one image
         gl_draw_img_center_scale(fid, scale);
+        gl_present();
         // block for user input
         kio_wait_key('q');
     }
@@ -85,6 +86,7 @@ uint8_t slideshow_main(uint8_t argc, char* argv[])
         do
         {
             gl_draw_img_center_scale(fid, scale);
+            gl_present();
             key = kio_getchr_16bit();
             switch ((char)key)
             {
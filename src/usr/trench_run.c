@@ -11,8 +11,10 @@
 #include "trench_run.h"
 
 #include "../kern/clock.h"
+#include "../kern/fixed.h"
 #include "../kern/kio.h"
 #include "../kern/rng.h"
+#include "../gl/gl_3d.h"
 #include "../gl/gl_lib.h"
 #include "../gl/pane.h"
 
@@ -31,6 +33,21 @@
 #define STAR_PROB       77  // year the movie came out
 // padding on targeting computer border
 #define TCB_PAD         1
+// trench, in world units: the walls are TRENCH_W apart and TRENCH_D high,
+// with ribs across them every TRENCH_RIB. TRENCH_RIBS lengths of it are in
+// view at once
+#define TRENCH_W        64
+#define TRENCH_D        36
+#define TRENCH_RIB      32
+#define TRENCH_RIBS     8
+#define TRENCH_LEN      (TRENCH_RIB * TRENCH_RIBS)
+// height the camera flies at, down the middle of the trench
+#define TRENCH_CAM_Y    24
+// distance flown each frame and the closest anything is drawn, 16.16
+#define TRENCH_SPEED    (FIX16_ONE + (FIX16_ONE / 2))
+#define TRENCH_NEAR     FIX16_ONE
+// end points of every line in a frame: 3 per rib and 2 per wall stripe
+#define TRENCH_PTS      ((((TRENCH_RIBS + 1) * 3) + (2 * 5)) * 2)
 
 /*
 ** Initializes program structure
@@ -52,7 +69,7 @@ void trench_run_init(Program* prog)
 ** @param tr_ul Upper-left point on trench corner (near plane)
 ** @param ctr_ul Upper-left point on center corner (far plane)
 ** @param ctr_ur Upper-right point on center corner (far plane)
-** @param tr_ur Upper-right point on trench corner (far plane)
+** @param tr_ur Upper-right point on trench corner (near plane)
 */
 static void __trench_run_render_stars(uint16_t seed,
     Point_2D tr_ul, Point_2D ctr_ul, Point_2D ctr_ur, Point_2D tr_ur)
@@ -70,6 +87,13 @@ static void __trench_run_render_stars(uint16_t seed,
     uint16_t dx = (seed % 35) + 1;
     uint16_t dy = ((seed % 4) + 1) * 3;
 
+    // slopes of the top edges of the trench, as the change in x on each row.
+    // The edges are solved once; each star only needs a multiply per edge
+    fix16_t ul_slope = fix_div(FIX16(ctr_ul.x - tr_ul.x),
+        FIX16(ctr_ul.y - tr_ul.y));
+    fix16_t ur_slope = fix_div(FIX16(ctr_ur.x - tr_ur.x),
+        FIX16(ctr_ur.y - tr_ur.y));
+
     // counts the cycles
     uint16_t cntr = 0;
     // procedurally draw stars; attempting to make some amount of noise
@@ -80,19 +104,12 @@ static void __trench_run_render_stars(uint16_t seed,
         // bounds check; fill in the upper trapazoid of space
         if (cursor.y > tr_ul.y)
         {
-            // solve the lines
-            // Form of equation in use: 2 point form
-            // x(dy) - y(dx) = x1y2 - x2y1; dy = y2-y1; dx = x2 - x1
-            // Upper-left top edge of the trench
-            int16_t ul_dx = ctr_ul.x - tr_ul.x, ul_dy = ctr_ul.y - tr_ul.y;
-            int16_t ul_eq = (tr_ul.x * ctr_ul.y) - (ctr_ul.x * tr_ul.y);
-            int16_t cur_ul_eq = (cursor.x * ul_dy) - (cursor.y * ul_dx);
-            // Upper-right top edge of the trench
-            int16_t ur_dx = ctr_ur.x - tr_ur.x, ur_dy = ctr_ur.y - tr_ur.y;
-            int16_t ur_eq = (tr_ur.x * ctr_ur.y) - (ctr_ur.x * tr_ur.y);
-            int16_t cur_ur_eq = (cursor.x * ur_dy) - (cursor.y * ur_dx);
+            // find where the top edges of the trench are on this row
+            int32_t fix_x = FIX16(cursor.x);
+            int32_t ul_x = FIX16(tr_ul.x) + (ul_slope * (cursor.y - tr_ul.y));
+            int32_t ur_x = FIX16(tr_ur.x) + (ur_slope * (cursor.y - tr_ur.y));
             // see if we should draw this
-            if ((cur_ul_eq > ul_eq) && (cur_ur_eq < ur_eq))
+            if ((fix_x > ul_x) && (fix_x < ur_x))
             {
                 if (rng_fetch_range(STAR_PROB_LO, STAR_PROB_HI) > STAR_PROB)
                     gl_put_pixel(cursor, RGB_WHITE);
@@ -127,35 +144,86 @@ static void __trench_run_render_stars(uint16_t seed,
 }
 
 /*
-** Procedurally draw the Death Star trench run
+** Draws the stars above the trench. The RNG is restarted from the seed, so
+** the stars come out the same every time this is called with the same seed
 **
+** @param cam Camera flying down the trench
 ** @param seed Seed value to use in rendering
 */
-static void __trench_run_render_frame(uint16_t seed)
+static void __trench_run_draw_stars(const GL_Cam* cam, uint16_t seed)
 {
-    // calculate values relative to the screen size
-    uint16_t fr_w = gl_getw();
-    uint16_t fr_h = gl_geth();
-    Point_2D ctr_pt = {fr_w / 2, fr_h / 2};
-    // box surrounding near plane of the image, the start of the corner lines
-    Point_2D tr_ul = {0, fr_h / 4};
-    Point_2D tr_lr = {fr_w, fr_h};
-    // box surrounding center point, "openning" to the trench (far plane)
-    Point_2D ctr_ul = {ctr_pt.x - (fr_w / 16), ctr_pt.y - (fr_h / 16)};
-    Point_2D ctr_lr = {ctr_pt.x + (fr_w / 16), ctr_pt.y + (fr_h / 16)};
+    // the top edges of the trench run straight at the point the camera looks
+    // at, so where they meet the sides of the screen depends only on where
+    // the camera is in the trench
+    uint16_t edge_y = cam->ctr.y
+        - ((TRENCH_D - TRENCH_CAM_Y) * cam->ctr.x) / (TRENCH_W / 2);
+    Point_2D tr_ul = {0, edge_y};
+    Point_2D tr_ur = {cam->w, edge_y};
+    // the stars stop at the far end of the trench
+    Point_2D ctr_ul = cam->ctr, ctr_ur = cam->ctr;
+    gl_project_3d(cam, PT3(0, TRENCH_D, TRENCH_LEN), &ctr_ul);
+    gl_project_3d(cam, PT3(TRENCH_W, TRENCH_D, TRENCH_LEN), &ctr_ur);
+    // 0 would seed the RNG from the clock instead
+    rng_init(seed + 1);
+    __trench_run_render_stars(seed, tr_ul, ctr_ul, ctr_ur, tr_ur);
+}
 
-    // generate stars
-    __trench_run_render_stars(seed, tr_ul, ctr_ul,
-        PT2(ctr_lr.x, ctr_ul.y), PT2(tr_ul.x, tr_ul.y));
+/*
+** Draws the Death Star trench run, as seen from a camera flying down it. The
+** trench repeats every rib, so the camera only ever moves along one rib's
+** length and the ribs are shifted along as it passes them
+**
+** @param cam Camera to draw with
+** @param seed Seed value for the trench, which picks where the ribs are
+** @param fr Frame seed, which picks the stars and the targeting number
+** @param rib Number of ribs passed so far
+** @param z Distance past the last rib, 16.16
+*/
+static void __trench_run_render_frame(GL_Cam* cam, uint16_t seed,
+    uint16_t fr, uint16_t rib, fix16_t z)
+{
+    gl_clrscr();
+    gl_mat_identity(&cam->view);
+    gl_mat_translate(&cam->view, -FIX16(TRENCH_W / 2), -FIX16(TRENCH_CAM_Y),
+        -z);
+    __trench_run_draw_stars(cam, fr);
+
+    // ribs across the walls and floor. The seed decides which are there,
+    // except for the far end, which is always closed off
+    Point_3D pts[TRENCH_PTS];
+    uint16_t n = 0;
+    for (uint8_t i=0; i<=TRENCH_RIBS; ++i)
+    {
+        if ((i < TRENCH_RIBS) && (((seed + rib + i) % 3) == 0))
+            continue;
+        uint16_t rib_z = i * TRENCH_RIB;
+        pts[n++] = PT3(0, TRENCH_D, rib_z);
+        pts[n++] = PT3(0, 0, rib_z);
+        pts[n++] = PT3(0, 0, rib_z);
+        pts[n++] = PT3(TRENCH_W, 0, rib_z);
+        pts[n++] = PT3(TRENCH_W, 0, rib_z);
+        pts[n++] = PT3(TRENCH_W, TRENCH_D, rib_z);
+    }
+    // the corners of the trench and the stripes on its walls run its length
+    for (uint8_t i=0; i<5; ++i)
+    {
+        uint16_t y = (TRENCH_D * i) / 4;
+        pts[n++] = PT3(0, y, 0);
+        pts[n++] = PT3(0, y, TRENCH_LEN);
+        pts[n++] = PT3(TRENCH_W, y, 0);
+        pts[n++] = PT3(TRENCH_W, y, TRENCH_LEN);
+    }
+    gl_draw_lines_3d_aa(cam, pts, n, ROGUE_YLW, RGB_BLACK);
 
     // "targetting computer" indicator, lower and center just like the movie
+    char tc_str[kio_sprintf_len("%06d", &fr, NULL)];
+    kio_sprintf("%06d", tc_str, &fr, NULL);
     Point_2D tc_ul = {0, 0};
     Point_2D tc_bb;
-    gl_draw_strf_bb(tc_ul, "%06d", 2, fr_w, &tc_bb, &seed, NULL);
-    tc_ul.x = (fr_w - tc_bb.x) / 2;
-    tc_ul.y = fr_h - (tc_bb.y + (tc_bb.y / 2));
-    gl_draw_strf_scale(tc_ul, ROGUE_RED, ROGUE_RED, "%06d", 2, fr_w, &seed,
-        NULL);
+    gl_draw_str_bb(tc_ul, tc_str, 2, cam->w, &tc_bb);
+    tc_ul.x = (cam->w - tc_bb.x) / 2;
+    tc_ul.y = cam->h - (tc_bb.y + (tc_bb.y / 2));
+    gl_draw_str_scale(tc_ul, ROGUE_RED, ROGUE_RED, tc_str, 2, cam->w);
 
     // draw frame around the letters
     Point_2D tcb_ul = {tc_ul.x - TCB_PAD, tc_ul.y - TCB_PAD};
@@ -163,148 +231,12 @@ static void __trench_run_render_frame(uint16_t seed)
         tc_ul.x + tc_bb.x + TCB_PAD,
         tc_ul.y + tc_bb.y + TCB_PAD
     };
-    gl_draw_line(tcb_ul, PT2(tcb_lr.x, tcb_ul.y), ROGUE_YLW);
-    gl_draw_line(tcb_ul, PT2(tcb_ul.x, tcb_lr.y), ROGUE_YLW);
-    gl_draw_line(PT2(tcb_ul.x, tcb_lr.y), tcb_lr, ROGUE_YLW);
-    gl_draw_line(PT2(tcb_lr.x, tcb_ul.y), tcb_lr, ROGUE_YLW);
-
-    // draw the corners of the trenches, based on the screen dimensions
-    // top corners of trench
-    gl_draw_line(tr_ul, ctr_ul, ROGUE_YLW);
-    gl_draw_line(PT2(tr_lr.x, tr_ul.y), PT2(ctr_lr.x, ctr_ul.y), ROGUE_YLW);
-    // bottom corners of trench
-    gl_draw_line(PT2(tr_ul.x, tr_lr.y), PT2(ctr_ul.x, ctr_lr.y), ROGUE_YLW);
-    gl_draw_line(tr_lr, ctr_lr, ROGUE_YLW);
-    // y values of upper middle stripe
-    uint16_t tr_md_u_y  = tr_ul.y  + ((tr_lr.y - tr_ul.y)   / 4);
-    uint16_t ctr_md_u_y = ctr_ul.y + ((ctr_lr.y - ctr_ul.y) / 4);
-    // y values of middle middle stripe
-    uint16_t tr_md_m_y  = tr_ul.y  + ((tr_lr.y - tr_ul.y)   / 2);
-    uint16_t ctr_md_m_y = ctr_ul.y + ((ctr_lr.y - ctr_ul.y) / 2);
-    // y values of lower middle stripe
-    uint16_t tr_md_l_y  = tr_ul.y  + ((tr_lr.y - tr_ul.y)   * 3 / 4);
-    uint16_t ctr_md_l_y = ctr_ul.y + ((ctr_lr.y - ctr_ul.y) * 3 / 4);
-    // middle lines, left side, upper to bottom
-    gl_draw_line(
-        PT2(tr_ul.x,  tr_md_u_y), PT2(ctr_ul.x, ctr_md_u_y), ROGUE_YLW
-    );
-    gl_draw_line(
-        PT2(tr_ul.x,  tr_md_m_y), PT2(ctr_ul.x, ctr_md_m_y), ROGUE_YLW
-    );
-    gl_draw_line(
-        PT2(tr_ul.x,  tr_md_l_y), PT2(ctr_ul.x, ctr_md_l_y), ROGUE_YLW
-    );
-    // middle lines, right side, upper to bottom
-    gl_draw_line(
-        PT2(tr_lr.x,  tr_md_u_y), PT2(ctr_lr.x, ctr_md_u_y), ROGUE_YLW
-    );
-    gl_draw_line(
-        PT2(tr_lr.x,  tr_md_m_y), PT2(ctr_lr.x, ctr_md_m_y), ROGUE_YLW
-    );
-    gl_draw_line(
-        PT2(tr_lr.x,  tr_md_l_y), PT2(ctr_lr.x, ctr_md_l_y), ROGUE_YLW
-    );
-
-    // bound the end of the trench
-    gl_draw_line(ctr_ul, PT2(ctr_ul.x, ctr_lr.y), ROGUE_YLW);
-    gl_draw_line(PT2(ctr_ul.x, ctr_lr.y), ctr_lr, ROGUE_YLW);
-    gl_draw_line(ctr_lr, PT2(ctr_lr.x, ctr_ul.y), ROGUE_YLW);
-
-    // trench lines determined by seed
-    uint16_t line_arr[3];
-    switch (seed % 3)
-    {
-        case 0:
-            line_arr[0] = (fr_w / 32) * 7;
-            line_arr[1] = (fr_w / 32) * 10;
-            line_arr[2] = (fr_w / 32) * 13;
-            break;
-        case 1:
-            line_arr[0] = 0;
-            line_arr[1] = (fr_w / 32) * 8;
-            line_arr[2] = (fr_w / 32) * 12;
-            break;
-        case 2:
-            line_arr[0] = (fr_w / 32) * 6;
-            line_arr[1] = 0;
-            line_arr[2] = (fr_w / 32) * 11;
-            break;
-    }
-    for(uint8_t tr_lines=0; tr_lines<3; ++tr_lines)
+    Point_2D tcb[] =
     {
-        uint16_t frac_w = line_arr[tr_lines];
-        // skip line
-        if (frac_w == 0)
-            continue;
-        Point_2D tr_p0 = {frac_w, 0};
-        Point_2D tr_p1 = tr_p0;
-
-        // cheaty way; solving equations without decimals is hard
-        // ...high school geometry is also hard, for the record
-        RGB_8 cmp_color = {0,0,0};
-        // find the first 2 yellow pixels to draw the left vertical bar
-        uint16_t y = 0;
-        for(; y<fr_h; ++y)
-        {
-            tr_p0.y = y;
-            gl_get_pixel(tr_p0, &cmp_color);
-            if (vga_RGB_8_cmp(cmp_color, ROGUE_YLW))
-            {
-                ++y;
-                break;
-            }
-        }
-        // ignore the middle lines
-        uint8_t ylw_cntr = 0;
-        for(; y<fr_h; ++y)
-        {
-            tr_p1.y = y;
-            gl_get_pixel(tr_p1, &cmp_color);
-            if (vga_RGB_8_cmp(cmp_color, ROGUE_YLW))
-            {
-                ++ylw_cntr;
-                if (ylw_cntr > 3)
-                    break;
-            }
-        }
-        gl_draw_line(tr_p0, tr_p1, ROGUE_YLW);
-        // finding the subsequent bars is easier since we know one dimension
-        // horizontal bar
-        tr_p0 = tr_p1;
-        // start looking for x past the center of the screen; this prevents
-        // issues with running into aliased flat lines; "the jaggies"
-        bool edge_found = false;
-        for(uint16_t x=(fr_w / 2)+1; x<fr_w; ++x)
-        {
-            tr_p0.x = x;
-            gl_get_pixel(tr_p0, &cmp_color);
-            if (vga_RGB_8_cmp(cmp_color, ROGUE_YLW))
-                edge_found = true;
-            if (edge_found && !vga_RGB_8_cmp(cmp_color, ROGUE_YLW))
-            {
-                tr_p0.x = x - 1;
-                break;
-            }
-        }
-        // handle the aliasing on the other side
-        gl_draw_line(tr_p1, tr_p0, ROGUE_YLW);
-        // last vertical bar, built just like the first one
-        tr_p1 = tr_p0;
-        y = tr_p1.y;
-        ylw_cntr = 0;
-        for(; y<fr_h; --y)
-        {
-            tr_p1.y = y;
-            gl_get_pixel(tr_p1, &cmp_color);
-            if (vga_RGB_8_cmp(cmp_color, ROGUE_YLW))
-            {
-                ++ylw_cntr;
-                if (ylw_cntr > 4)
-                    break;
-            }
-        }
-        gl_draw_line(tr_p0, tr_p1, ROGUE_YLW);
-    }
+        tcb_ul, PT2(tcb_lr.x, tcb_ul.y), tcb_lr, PT2(tcb_ul.x, tcb_lr.y),
+        tcb_ul
+    };
+    gl_draw_polyline(tcb, sizeof(tcb) / sizeof(tcb[0]), 1, ROGUE_YLW);
 }
 
 /*
@@ -312,8 +244,8 @@ static void __trench_run_render_frame(uint16_t seed)
 */
 uint8_t trench_run_main(uint8_t argc, char* argv[])
 {
-    // default to VGA13
-    pane_enter(VGA_MODE_13);
+    // Mode X, so frames are flipped onto the screen instead of redrawn on it
+    pane_enter(VGA_MODE_X);
     // set a theme that matches the look of the trench-run program
     pane_set_theme(
         &ROGUE_BLK, &RGB_BLACK,
@@ -348,26 +280,38 @@ uint8_t trench_run_main(uint8_t argc, char* argv[])
             break;
     }
 
-    RTC_Time t_cur, t_prev = {0, 0, 0};
-    // control the frame to draw
+    RTC_Time t_cur, t_prev;
+    clk_rtc_time(&t_prev);
+    // the stars and targeting number change every second; the run length
+    // counts seconds
     uint16_t fr = 0, cmp_fr= 0;
     char key = '\0';
-    // draw the plans w/ a seed; star placement is determined by an RNG
-    rng_init(seed);
+    // the camera flies on every frame
+    GL_Cam cam;
+    gl_cam_init(&cam, gl_getw() / 2, TRENCH_NEAR);
+    uint16_t rib = 0;
+    fix16_t z = 0;
     while((key != 'q') && (cmp_fr < run_len))
     {
         // animation control w/ timer
         clk_rtc_time(&t_cur);
         if (clk_rtc_diff(t_cur, t_prev))
         {
-            gl_clrscr();
-            __trench_run_render_frame(seed + fr);
             t_prev = t_cur;
             ++fr;
             // allows us to have an infinite draw scheme
             if (run_len != INFINITE_MODE)
                 ++cmp_fr;
         }
+        // draw the plans w/ a seed; star placement is determined by an RNG
+        __trench_run_render_frame(&cam, seed, seed + fr, rib, z);
+        gl_present();
+        z += TRENCH_SPEED;
+        if (z >= FIX16(TRENCH_RIB))
+        {
+            z -= FIX16(TRENCH_RIB);
+            ++rib;
+        }
         // non-blocking get chr
         key = kio_getchr_nb();
     }
@@ -11,10 +11,26 @@
 #include "usr_clock.h"
 
 #include "../kern/clock.h"
+#include "../kern/fixed.h"
 #include "../kern/kio.h"
+#include "../gl/dlist.h"
 #include "../gl/gl_lib.h"
+#include "../gl/gl_shape.h"
 #include "../gl/img_fids.h"
 
+/** Macros     **/
+// display list size; a frame only has a handful of things in it
+#define USR_CLOCK_DL_SIZE   512
+// scale of the background image
+#define USR_CLOCK_BG_SCALE  3
+// gap between the end of the second hand and the rim of the face
+#define USR_CLOCK_RIM_GAP   4
+// radius of the quarter hour marks and of the cap over the arms' center
+#define USR_CLOCK_MARK_RAD  2
+#define USR_CLOCK_CAP_RAD   3
+// length of the ticks at the other hours
+#define USR_CLOCK_TICK      3
+
 /*
 ** Initializes program structure
 **
@@ -30,120 +46,130 @@ void usr_clock_init(Program* prog)
 }
 
 /*
-** Draws an arm of a clock, following a square frame
-** For many reasons, using a circle model (which keeps the arm lengths
-** consistent in size) is not possible nor practical.
+** Finds the point at a distance and angle from the center of the clock
 **
 ** @param clk_center Center point of the clock
+** @param ang Angle, clockwise from 12 o'clock
+** @param rad Distance from the center
+** @return Point on the screen
+*/
+static Point_2D __usr_clock_point(Point_2D clk_center, fix_angle_t ang,
+    uint16_t rad)
+{
+    Point_2D pt = {
+        clk_center.x + FIX16_ROUND(fix_sin(ang) * rad),
+        clk_center.y - FIX16_ROUND(fix_cos(ang) * rad)
+    };
+    return pt;
+}
+
+/*
+** Draws an arm of a clock
+**
+** @param dl Display list to record the arm in
+** @param clk_center Center point of the clock
 ** @param width Clock arm width
 ** @param color Color of the clock arm
-** @param divisions Number of divisions in this time unit (i.e. seconds have
-**        60 divisions in a clock)
-** @param rad Arm radius. The bounding box of the clock is 2 radii wide
-** @param t_unit Time unit value of the arm
+** @param ang Angle of the arm, clockwise from 12 o'clock
+** @param rad Arm length
 */
-static void __usr_clock_draw_arm(Point_2D clk_center, uint8_t width,
-    RGB_8 color, uint16_t divisions, uint16_t rad, uint8_t t_unit)
+static void __usr_clock_draw_arm(DList* dl, Point_2D clk_center,
+    uint8_t width, RGB_8 color, fix_angle_t ang, uint16_t rad)
 {
-    // assume the end point of the arm starts at 12 o'clock position
-    Point_2D end_pt = clk_center;
-    // divisions of time in an octant
-    uint16_t oct_div = (divisions / 8) + 1;
-    // 1 unit of change in the sampling of an octant
-    uint16_t rad_frac = rad / oct_div;
-    // how far along a square's edge we travel, based on time
-    uint16_t travel = (t_unit % oct_div) * rad_frac;
-    // the error is much higher for the hour hand b/c there are far fewer
-    // divisions. This hack seems to correct the error and produce hour hands
-    // that are "good enough"
-    if (divisions == 12)
+    // draw a line from the center of the circle to the end of the arm
+    dlist_line(dl, clk_center, __usr_clock_point(clk_center, ang, rad), width,
+        color);
+}
+
+/*
+** Draws the face of the clock: the rim, a dot at each quarter hour and a tick
+** at each other hour. This is called back by the display list, so it draws
+** the same face every time
+**
+** @param rad Radius of the rim
+*/
+static void __usr_clock_draw_face(uint16_t rad)
+{
+    Point_2D ctr = {gl_getw() / 2, gl_geth() / 2};
+    gl_draw_circle(ctr, rad, RGB_WHITE);
+    uint16_t mark = rad - (2 * USR_CLOCK_MARK_RAD);
+    for (uint8_t hr=0; hr<12; ++hr)
     {
-        travel = ((t_unit % oct_div) + 1) * rad_frac;
-        if (t_unit == 6)
+        fix_angle_t ang = FIX_ANGLE_STEP(hr, 12);
+        if ((hr % 3) == 0)
         {
-            travel = rad;
-            t_unit = 7;
+            gl_fill_circle(__usr_clock_point(ctr, ang, mark),
+                USR_CLOCK_MARK_RAD, RGB_WHITE);
+        }
+        else
+        {
+            gl_draw_line(__usr_clock_point(ctr, ang, mark - USR_CLOCK_TICK),
+                __usr_clock_point(ctr, ang, mark), RGB_WHITE);
         }
-        else if (t_unit > 6)
-            t_unit += 2;
-    }
-    // a smaller error correction is made for the other two hands
-    else if (t_unit >= 30)
-        travel += (2 * rad_frac);
-    // determine the octant we're in
-    if      (t_unit < (1 * oct_div))   // 1st
-    {
-        end_pt.x += travel;
-        end_pt.y -= rad;
-    }
-    else if (t_unit < (2 * oct_div))   // 2nd
-    {
-        end_pt.x += rad;
-        end_pt.y = (end_pt.y - rad) + travel;
-    }
-    else if (t_unit < (3 * oct_div))   // 3rd
-    {
-        end_pt.x += rad;
-        end_pt.y += travel;
-    }
-    else if (t_unit < (4 * oct_div))   // 4th
-    {
-        end_pt.x += rad - travel;
-        end_pt.y += rad;
-    }
-    else if (t_unit < (5 * oct_div))   // 5th
-    {
-        end_pt.x -= travel;
-        end_pt.y += rad;
-    }
-    else if (t_unit < (6 * oct_div))   // 6th
-    {
-        end_pt.x -= rad;
-        end_pt.y += rad - travel;
-    }
-    else if (t_unit < (7 * oct_div))   // 7th
-    {
-        end_pt.x -= rad;
-        end_pt.y -= travel;
-    }
-    else //if (t_unit <= (8 * oct_div))    // 8th
-    {
-        end_pt.x -= rad - travel;
-        end_pt.y -= rad;
     }
-    // draw a line from the center of the circle to the end of the arm    
-    gl_draw_line_width(clk_center, end_pt, width, color);
 }
 
 /*
-** Renders a frame of the GUI clock
+** Draws the cap that covers the point the arms turn around
+**
+** @param rad Radius of the cap
+*/
+static void __usr_clock_draw_cap(uint16_t rad)
+{
+    gl_fill_circle(PT2(gl_getw() / 2, gl_geth() / 2), rad, RGB_WHITE);
+}
+
+/*
+** Renders a frame of the GUI clock. Only the parts that changed since the last
+** frame are drawn again
 **
+** @param dl Display list holding the frame on the screen
 ** @param t Current time
 ** @param t_str Time in string form
 */
-static void __usr_clock_render_gui(RTC_Time t, char* t_str)
+static void __usr_clock_render_gui(DList* dl, RTC_Time t, char* t_str)
 {
-    gl_clrscr();
-    // draw an appropriate background
-    gl_draw_img_center_scale(IMG_FID_DSTM, 3);
+    dlist_begin(dl);
+    // draw an appropriate background, centered
+    Point_2D img_ul;
+    gl_img_stat(IMG_FID_DSTM, &img_ul);
+    uint16_t img_w = img_ul.x * USR_CLOCK_BG_SCALE;
+    uint16_t img_h = img_ul.y * USR_CLOCK_BG_SCALE;
+    img_ul.x = (gl_getw() > img_w) ? (gl_getw() - img_w) / 2 : 0;
+    img_ul.y = (gl_geth() > img_h) ? (gl_geth() - img_h) / 2 : 0;
+    dlist_img(dl, IMG_FID_DSTM, img_ul, USR_CLOCK_BG_SCALE);
 
     // draw digital clock, which looks cool, top & centered
     Point_2D digi_bb;
     gl_draw_str_bb(PT2(0, 0), t_str, 1, gl_getw(), &digi_bb);
     Point_2D digi_ul = {(gl_getw() - digi_bb.x) / 2, digi_bb.y};
-    gl_draw_str(digi_ul, RGB_WHITE, RGB_WHITE, t_str);
+    dlist_str(dl, digi_ul, RGB_WHITE, RGB_WHITE, t_str, 1, gl_getw());
 
-    // draw three clock arms based on the current time
+    // draw the face under the arms
     Point_2D clk_center = {gl_getw() / 2, gl_geth() / 2};
+    uint16_t face_rad = (gl_getw() / 6) + USR_CLOCK_RIM_GAP;
+    dlist_call(dl, &__usr_clock_draw_face, face_rad,
+        PT2(clk_center.x - face_rad, clk_center.y - face_rad),
+        (2 * face_rad) + 1, (2 * face_rad) + 1);
+
+    // draw three clock arms based on the current time
     // draw fastest moving to slowest moving (longest arm to shortest) in case
     // of any overlap
     // sec
-    __usr_clock_draw_arm(clk_center, 1, RGB_YELLOW, 60, gl_getw() / 6, t.sec);
-    // min
-    __usr_clock_draw_arm(clk_center, 2, RGB_CYAN, 60, gl_getw() / 9, t.min);
-    // hr
-    uint8_t hr = (t.hr > 12) ? t.hr - 12 : t.hr;
-    __usr_clock_draw_arm(clk_center, 3, RGB_MAGENTA, 12, gl_getw() / 18, hr);
+    __usr_clock_draw_arm(dl, clk_center, 1, RGB_YELLOW,
+        FIX_ANGLE_STEP(t.sec, 60), gl_getw() / 6);
+    // min, moving on a little each second
+    __usr_clock_draw_arm(dl, clk_center, 2, RGB_CYAN,
+        FIX_ANGLE_STEP((t.min * 60) + t.sec, 60 * 60), gl_getw() / 9);
+    // hr, moving on a little each minute
+    __usr_clock_draw_arm(dl, clk_center, 3, RGB_MAGENTA,
+        FIX_ANGLE_STEP(((t.hr % 12) * 60) + t.min, 12 * 60), gl_getw() / 18);
+    dlist_call(dl, &__usr_clock_draw_cap, USR_CLOCK_CAP_RAD,
+        PT2(clk_center.x - USR_CLOCK_CAP_RAD,
+        clk_center.y - USR_CLOCK_CAP_RAD),
+        (2 * USR_CLOCK_CAP_RAD) + 1, (2 * USR_CLOCK_CAP_RAD) + 1);
+    dlist_end(dl);
+    gl_present();
 }
 
 /*
@@ -175,13 +201,17 @@ uint8_t usr_clock_main(uint8_t argc, char* argv[])
         kio_clrscr();
     }
     else if (argc == 1)
-        gl_enter(VGA_MODE_13);
+        gl_enter(VGA_MODE_X);
     else
         return ERR_PROG_USAGE;
 
     // time tracking data
     RTC_Time t_cur, t_prev = {0, 0, 0};
     char t_buff[RTC_STR_BUFF_SIZE];
+    // the background and most of the arms stay put from second to second
+    DList dl;
+    uint8_t dl_buff[USR_CLOCK_DL_SIZE];
+    dlist_init(&dl, dl_buff, sizeof(dl_buff), RGB_BLACK);
     char key = '\0';
     do
     {
@@ -191,7 +221,7 @@ uint8_t usr_clock_main(uint8_t argc, char* argv[])
         {
             clk_rtc_str(t_buff, t_cur, false);
             if (gui_mode)
-                __usr_clock_render_gui(t_cur, t_buff);
+                __usr_clock_render_gui(&dl, t_cur, t_buff);
             else
                 __usr_clock_render_txt(t_cur, t_buff);
             t_prev = t_cur;
@@ -0,0 +1,69 @@
+#!/usr/bin/python3
+##
+## File:    fix_sin_tbl.py
+##
+## Author:  Schuyler Martin <sam8050@rit.edu>
+##
+## Description: Generates the quarter-wave sine table used by the fixed point
+##              math library (src/kern/fixed.c). The table covers 0 to 90
+##              degrees in equal steps, including both ends. Entries are
+##              unsigned 0.16 fixed point; sin(90) can't be stored as 1.0, so
+##              it is saturated to the largest value that fits.
+##
+##              The table is written to stdout:
+##                  ./fix_sin_tbl.py > ../src/kern/fix_sin_tbl.h
+##
+
+# Python libraries
+import math
+
+# number of steps in a quarter turn, as a power of 2. Must match what fixed.c
+# expects
+TBL_BITS = 6
+# entries per line of output
+LINE_CNT = 8
+
+def main():
+    '''
+    Prints the table as a C header
+    '''
+    steps = 1 << TBL_BITS
+    vals = []
+    for i in range(steps + 1):
+        val = round(math.sin((math.pi / 2) * i / steps) * 65536)
+        vals.append(min(val, 0xFFFF))
+    print("/*")
+    print("** File:    fix_sin_tbl.h")
+    print("**")
+    print("** Author:  Schuyler Martin <sam8050@rit.edu>")
+    print("**")
+    print("** Description: Quarter-wave sine table, generated by "
+        "tools/fix_sin_tbl.py.")
+    print("**              Do not edit by hand. Only fixed.c should include "
+        "this")
+    print("*/")
+    print("#ifndef _FIX_SIN_TBL_H_")
+    print("#define _FIX_SIN_TBL_H_")
+    print("")
+    print("/** Headers    **/")
+    print("#include \"gcc16.h\"")
+    print("#include \"types.h\"")
+    print("")
+    print("/** Macros     **/")
+    print("// steps in a quarter turn, as a power of 2")
+    print("#define FIX_SIN_TBL_BITS    %d" % TBL_BITS)
+    print("")
+    print("/** Globals    **/")
+    print("// sin(0) through sin(90), unsigned 0.16 fixed point")
+    print("static const uint16_t fix_sin_tbl[(1 << FIX_SIN_TBL_BITS) + 1] =")
+    print("{")
+    for i in range(0, len(vals), LINE_CNT):
+        line = ", ".join("0x%04X" % v for v in vals[i:i + LINE_CNT])
+        end = "," if (i + LINE_CNT) < len(vals) else ""
+        print("    " + line + end)
+    print("};")
+    print("")
+    print("#endif")
+
+if __name__ == "__main__":
+    main()